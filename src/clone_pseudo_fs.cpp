@@ -21,10 +21,14 @@ static const char * const version_str = "0.90 20231220 [svn: r28]";
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <cstdint>
+#include <cstddef>              // offsetof()
 #include <filesystem>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <array>
 #include <bit>
 #include <span>
 #include <ranges>
@@ -34,22 +38,47 @@ static const char * const version_str = "0.90 20231220 [svn: r28]";
 #include <chrono>
 #include <cstring>              // needed for strstr()
 #include <cstdio>               // using sscanf()
+#include <cinttypes>            // PRIu64
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <charconv>             // std::from_chars()
+#include <utility>              // std::exchange()
 // Unix C headers below
 #include <unistd.h>
+#include <sched.h>              // sched_setaffinity()
 #include <getopt.h>
 #include <fcntl.h>
 #include <glob.h>
+#include <dirent.h>
 #include <poll.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/vfs.h>            // statfs()
+#include <sys/sysmacros.h>      // major(), minor()
+#include <linux/magic.h>
+#include <linux/fs.h>           // FICLONE
+
+#if defined(__x86_64__)
+#include <immintrin.h>          // SSE2 and AVX2 intrinsics
+#endif
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#ifdef HAVE_LIBZ
+#include <zlib.h>               // compress2() for --squashfs=
+#endif
+
 // Bill Weinman's header library for C++20 follows. Expect to drop if moved
 // to >= C++23 and then s/bw::print/std::print/
 #include "bwprint.hpp"
 
+// 64 bit non-cryptographic hash (XXH3 style) of regular file contents
+#include "cpf_hash.hpp"
+
 static const unsigned int def_reglen { 256 };
 static const int reg_re_read_sz { 1024 };
 
@@ -77,7 +106,7 @@ struct opts_t;
 
 static auto & scout { std::cout };
 static auto & scerr { std::cerr };
-static fs::path prev_rdi_pt;
+static thread_local sstring prev_rdi_s;  // last node visited by a scan
 
 static int cpf_verbose;  // in 'struct opts_t' and file scope here ..
 
@@ -92,15 +121,241 @@ static bool want_sloc { };      // set if DEBUG and -vV not given
 template<class... Ts>
 struct overloaded : Ts... { using Ts::operator()...; };
 
+// pr_err() calls whose vb_ge is at or above this level are removed at
+// compile time. The default keeps all of them. For example building with
+// -DCPF_PR_ERR_MAX_VB=3 strips the chatty per-node messages (vb_ge >= 3).
+// Messages with vb_ge==-1 (always print) can not be stripped.
+#ifndef CPF_PR_ERR_MAX_VB
+#define CPF_PR_ERR_MAX_VB 99
+#endif
+
+// Asynchronous logger, active when the --log=LFILE option is given. Each
+// thread that calls pr_err() gets its own single producer, single consumer
+// ring buffer so posting a message takes no lock and never waits on I/O.
+// A writer thread drains all the rings into LFILE. If a message does not
+// fit in its ring, it is dropped and counted. Error messages (vb_ge < 0) are
+// also written to stderr so they are never lost. When a thread exits its
+// ring goes on a free list for the next new thread, so the number of rings
+// is that of threads logging at the same time, not of all those started.
+struct log_ring_t {
+    static const size_t ring_sz { 256 * 1024 };   // must be power of 2
+
+    std::atomic<size_t> head { };       // only the producer advances this
+    std::atomic<size_t> tail { };       // only the writer advances this
+    char buf[ring_sz];
+};
+
+class async_log_t {
+public:
+    ~async_log_t() { stop(); }
+
+    // Returns 0 on success, else a Unix like errno value is returned.
+    int start(const char * log_fn) noexcept;
+    void stop() noexcept;
+
+    bool active() const noexcept { return fp != nullptr; }
+
+    // Called by producers (any thread). Whole messages or nothing.
+    void post(const sstring & msg) noexcept;
+
+    uint64_t num_dropped() const noexcept { return dropped.load(); }
+
+private:
+    // Gives this thread's ring back to the free list when the thread exits
+    struct ring_owner_t {
+        ~ring_owner_t() {
+            if (rp)
+                logp->put_ring(rp);
+        }
+
+        async_log_t * logp { };
+        log_ring_t * rp { };
+    };
+
+    log_ring_t * get_ring() noexcept;
+    void put_ring(log_ring_t * rp) noexcept;
+    size_t drain() noexcept;
+    void writer() noexcept;
+
+    FILE * fp { };
+    std::thread wr_thr;
+    std::atomic<bool> stopping { };
+    std::atomic<uint64_t> dropped { };
+    std::mutex rings_mtx;       // taken briefly: no I/O while held
+    std::vector<std::unique_ptr<log_ring_t>> rings;
+    std::vector<log_ring_t *> free_v;   // capacity kept >= rings.size()
+    std::vector<log_ring_t *> drain_v;  // only used by drain()
+    static thread_local ring_owner_t tl_owner;
+};
+
+thread_local async_log_t::ring_owner_t async_log_t::tl_owner;
+
+static async_log_t cpf_alog;
+
+int
+async_log_t::start(const char * log_fn) noexcept
+{
+    fp = fopen(log_fn, "w");
+    if (fp == nullptr)
+        return errno;
+    try {
+        wr_thr = std::thread(&async_log_t::writer, this);
+    }
+    catch (...) {
+        fclose(fp);
+        fp = nullptr;
+        return EAGAIN;
+    }
+    return 0;
+}
+
+void
+async_log_t::stop() noexcept
+{
+    if (fp == nullptr)
+        return;
+    stopping = true;
+    if (wr_thr.joinable())
+        wr_thr.join();
+    drain();
+    if (dropped > 0) {
+        fprintf(fp, ">> async log: %" PRIu64 " messages dropped\n",
+                dropped.load());
+        fprintf(stderr, ">> async log: %" PRIu64 " messages dropped\n",
+                dropped.load());
+    }
+    fclose(fp);
+    fp = nullptr;
+}
+
+log_ring_t *
+async_log_t::get_ring() noexcept
+{
+    if (tl_owner.rp)
+        return tl_owner.rp;
+    try {
+        {
+            std::lock_guard<std::mutex> lk { rings_mtx };
+
+            if (! free_v.empty()) {
+                tl_owner.rp = free_v.back();
+                free_v.pop_back();
+            }
+        }
+        if (tl_owner.rp == nullptr) {
+            auto up { std::make_unique<log_ring_t>() };
+            std::lock_guard<std::mutex> lk { rings_mtx };
+
+            free_v.reserve(rings.size() + 1);   // so put_ring() cannot throw
+            tl_owner.rp = up.get();
+            rings.push_back(std::move(up));
+        }
+    }
+    catch (...) {
+        return nullptr;
+    }
+    tl_owner.logp = this;
+    return tl_owner.rp;
+}
+
+// Any messages left in rp are still written by the writer thread
+void
+async_log_t::put_ring(log_ring_t * rp) noexcept
+{
+    std::lock_guard<std::mutex> lk { rings_mtx };
+
+    free_v.push_back(rp);
+}
+
+void
+async_log_t::post(const sstring & msg) noexcept
+{
+    const size_t n { msg.size() };
+    const size_t mask { log_ring_t::ring_sz - 1 };
+    log_ring_t * rp { get_ring() };
+
+    if (rp == nullptr) {
+        ++dropped;
+        return;
+    }
+    size_t h { rp->head.load(std::memory_order_relaxed) };
+    size_t t { rp->tail.load(std::memory_order_acquire) };
+
+    if ((log_ring_t::ring_sz - (h - t)) < n) {
+        ++dropped;
+        return;
+    }
+    size_t off { h & mask };
+    size_t n1 { std::min(n, log_ring_t::ring_sz - off) };
+
+    memcpy(rp->buf + off, msg.data(), n1);
+    if (n1 < n)
+        memcpy(rp->buf, msg.data() + n1, n - n1);
+    rp->head.store(h + n, std::memory_order_release);
+}
+
+// Returns number of bytes written to the log file.
+size_t
+async_log_t::drain() noexcept
+{
+    size_t total { };
+    const size_t mask { log_ring_t::ring_sz - 1 };
+
+    // rings are never freed before this object, so their pointers can be
+    // used after the lock is released; file I/O is done without it
+    try {
+        std::lock_guard<std::mutex> lk { rings_mtx };
+
+        drain_v.clear();
+        for (const auto & up : rings)
+            drain_v.push_back(up.get());
+    }
+    catch (...) {
+        return 0;
+    }
+    for (log_ring_t * rp : drain_v) {
+        size_t t { rp->tail.load(std::memory_order_relaxed) };
+        size_t h { rp->head.load(std::memory_order_acquire) };
+
+        if (h == t)
+            continue;
+        size_t n { h - t };
+        size_t off { t & mask };
+        size_t n1 { std::min(n, log_ring_t::ring_sz - off) };
+
+        fwrite(rp->buf + off, 1, n1, fp);
+        if (n1 < n)
+            fwrite(rp->buf, 1, n - n1, fp);
+        rp->tail.store(h, std::memory_order_release);
+        total += n;
+    }
+    return total;
+}
+
+void
+async_log_t::writer() noexcept
+{
+    while (! stopping.load()) {
+        if (drain() == 0) {
+            fflush(fp);
+            std::this_thread::sleep_for(chron::milliseconds(2));
+        }
+    }
+}
+
+// When is_err is true the message goes to stderr even when --log is active
+// since post() may drop it.
 template<typename... Args>
-    constexpr void pr_err(int vb_ge, const std::string_view str_fmt,
-                          Args&&... args) noexcept {
-        if (vb_ge >= cpf_verbose)       // vb_ge==-1 always prints
-            return;
+    void pr_err_emit(bool is_err, const std::string_view str_fmt,
+                     Args&&... args) noexcept {
         try {
-        fputs(BWP_FMTNS::vformat(str_fmt,
-                                 BWP_FMTNS::make_format_args(args...)).c_str(),
-                                 stderr);
+            const sstring msg { BWP_FMTNS::vformat(str_fmt,
+                                BWP_FMTNS::make_format_args(args...)) };
+
+            if (cpf_alog.active())
+                cpf_alog.post(msg);
+            if (is_err || (! cpf_alog.active()))
+                fputs(msg.c_str(), stderr);
         }
         catch (...) {
             scerr << "pr_err: vformat: threw exception, str_fmt: "
@@ -108,6 +363,18 @@ template<typename... Args>
         }
 }
 
+// pr_err(vb_ge, str_fmt, args...) prints to stderr when vb_ge is less than
+// the verbosity; vb_ge==-1 always prints (to stderr, even with --log). It
+// is a macro (rather than a function template) so the verbosity check is
+// done before any of its arguments are evaluated. Many calls in the scan
+// loops have arguments like s(pt) and l() that build strings; those are now
+// only built when the message will actually be printed.
+#define pr_err(vb_ge, ...)                                              \
+    do {                                                                \
+        if (((vb_ge) < CPF_PR_ERR_MAX_VB) && ((vb_ge) < cpf_verbose))   \
+            pr_err_emit((vb_ge) < 0, __VA_ARGS__);                      \
+    } while (0)
+
 // to print to stdout use bw::print(str_fmt, ....);
 
 template<typename... Args>
@@ -226,6 +493,73 @@ struct inmem_fifo_socket_t : inmem_base_t {
     void debug(const sstring & intro = "") const noexcept;
 };
 
+// Bump allocator for cached regular file contents that are too long to be
+// held inline (see inmem_contents_t). Each clone has its own arena (see
+// mut_opts_t::arenap) and nothing is freed until that arena is destroyed,
+// so a pointer into it stays valid for as long as the clone's cache tree.
+// Each thread carves from its own current chunk, the mutex is only taken
+// to add a chunk.
+class contents_arena_t {
+public:
+    contents_arena_t() noexcept : id(++next_id) { }
+
+    // Returns a copy of [bp, bp + n) in the arena, nullptr if no memory
+    const uint8_t * store(const uint8_t * bp, size_t n) noexcept;
+
+private:
+    static const size_t chunk_sz { 256 * 1024 };
+
+    // The thread's current chunk belongs to the arena whose id is tl_id.
+    // Unlike an address, an id is not reused by a later arena.
+    const uint64_t id;
+    std::mutex chunk_mtx;
+    std::vector<std::unique_ptr<uint8_t[]>> chunk_v;
+    static inline std::atomic<uint64_t> next_id { };
+    static thread_local uint64_t tl_id;
+    static thread_local uint8_t * tl_next;
+    static thread_local size_t tl_left;
+};
+
+thread_local uint64_t contents_arena_t::tl_id { };
+thread_local uint8_t * contents_arena_t::tl_next { };
+thread_local size_t contents_arena_t::tl_left { };
+
+// arena of a lone clone, left for the process exit to reclaim
+static contents_arena_t contents_arena;
+
+// Contents of a cached regular file. Up to inl_max bytes (nearly all sysfs
+// attributes) are held in the object itself, longer ones in the clone's
+// contents arena.
+// Copying is cheap: inline bytes are copied, arena bytes are shared.
+class inmem_contents_t {
+public:
+    static const size_t inl_max { 32 };
+
+    // Returns false (and is left empty) if arena memory is exhausted
+    bool assign(const uint8_t * bp, size_t n,
+                contents_arena_t & arena) noexcept;
+
+    bool empty() const noexcept { return sz == 0; }
+    size_t size() const noexcept { return sz; }
+    const uint8_t * data() const noexcept
+                { return (sz <= inl_max) ? u.inl : u.ext; }
+
+    operator std::span<const uint8_t>() const noexcept
+                { return { data(), sz }; }
+
+private:
+    uint32_t sz { };
+    union {
+        uint8_t inl[inl_max];
+        const uint8_t * ext;
+    } u { };
+};
+
+// Tag byte followed by a LEB128 varint (at most 10 bytes for 64 bits)
+using num_enc_t = std::array<uint8_t, 12>;
+// Longest rendering: '-', 20 decimal digits, then a newline
+static constexpr size_t num_render_max { 24 };
+
 struct inmem_regular_t : inmem_base_t {
     inmem_regular_t() = default;
     inmem_regular_t(const sstring & filename_, const short_stat & a_shstat)
@@ -233,17 +567,29 @@ struct inmem_regular_t : inmem_base_t {
 
     inmem_regular_t(const inmem_regular_t & oth) noexcept :
         inmem_base_t(oth), contents(oth.contents),
+        contents_hash(oth.contents_hash), num_enc(oth.num_enc),
         read_found_nothing(oth.read_found_nothing),
         always_use_contents(oth.always_use_contents)
         { }
 
     inmem_regular_t(inmem_regular_t && oth) noexcept :
         inmem_base_t(oth), contents(oth.contents),
+        contents_hash(oth.contents_hash), num_enc(oth.num_enc),
         read_found_nothing(oth.read_found_nothing),
         always_use_contents(oth.always_use_contents)
         { }
 
-    std::vector<uint8_t> contents { };
+    inmem_contents_t contents { };
+
+    // cpf_hash::hash64() of contents, computed when contents are set with
+    // --dedup or --squashfs=SQIMG active (which use it rather than hash the
+    // contents again), otherwise 0
+    uint64_t contents_hash { };
+
+    // With --compact, contents that are a single integer (e.g. "0\n",
+    // "0x8086\n" or "-1\n") are held here as a tagged varint and contents
+    // is left empty. num_enc[0] is the tag, 0 when not in use.
+    num_enc_t num_enc { };
 
     bool read_found_nothing { };
 
@@ -251,6 +597,17 @@ struct inmem_regular_t : inmem_base_t {
 
     sstring get_filename() const noexcept { return filename; }
 
+    bool is_numeric() const noexcept { return num_enc[0] != 0; }
+
+    // Places the original contents in a_bp (at least num_render_max bytes
+    // long) when in compact form and returns a span over them. Otherwise
+    // returns a span over contents.
+    std::span<const uint8_t> get_contents(uint8_t * a_bp) const noexcept;
+
+    // Returns true and sets the magnitude and sign if contents are a
+    // single integer, regardless of how they are held.
+    bool get_numeric(uint64_t & val, bool & negative) const noexcept;
+
     void debug(const sstring & intro = "") const noexcept;
 };
 
@@ -353,6 +710,9 @@ struct inmem_subdirs_t {
     void debug(const sstring & intro = "") const noexcept;
 };
 
+// the cache tree of a lone clone, left for the process exit to reclaim
+static const inmem_t * exit_cache_rtp { };
+
 enum class inmem_var_e {
     var_other = 0,      // matching inmem_t::derived.index()
     var_dir,
@@ -397,6 +757,9 @@ struct stats_t {
     unsigned int num_mknod_d_fail;
     unsigned int num_mknod_d_eacces;
     unsigned int num_mknod_d_eperm;
+    unsigned int num_dev_manifest;  // --dev-manifest: nodes recorded
+    unsigned int num_meta_set;      // --preserve: nodes given metadata
+    unsigned int num_meta_err;
     unsigned int num_prune_exact;
     unsigned int num_pruned_node;
     unsigned int num_prune_sym_pt_err;
@@ -424,25 +787,154 @@ struct stats_t {
     unsigned int num_reg_d_enoent_enodev_enxio;
     unsigned int num_reg_d_e_other;
     unsigned int num_reg_from_cache_err;
+    unsigned int num_reg_compact;   // contents held in compact numeric form
+    unsigned int num_reg_s_trace_skip;  // see trace_consuming()
+    unsigned int num_reg_d_linked;  // --dedup: hard links, not new files
+    unsigned int num_reg_d_link_err;
+    unsigned int num_reg_d_reflinked;   // --rollover: extents of PREV file
+    unsigned int num_reg_d_reflink_err;
+    unsigned int num_proc_pid;      // --procfs: processes harvested
+    unsigned int num_proc_tid;      // --procfs=...,task: threads harvested
+    unsigned int num_proc_gone;     // exited between listing and harvest
+    unsigned int num_proc_file;
+    unsigned int num_proc_file_err;
+    unsigned int num_cgrp_dir;      // --cgroup: cgroups harvested
+    unsigned int num_cgrp_gone;     // removed between listing and harvest
+    unsigned int num_cgrp_file;
+    unsigned int num_cgrp_file_err;
+    unsigned int num_col_table;     // --columnar: tables written
+    unsigned int num_col_row;
+    unsigned int num_col_err;
+    unsigned int num_sqfs_inode;    // --squashfs: inodes in SQIMG
+    unsigned int num_sqfs_shared;   // regular files sharing earlier data
     int max_depth;
 };
 
+// Scan policies. The source scan loops in clone_work_pol() and
+// cache_src_pol() are templates taking one of these. Each member says
+// whether the associated option(s) may be active. When a member is false
+// the per-node test of that option is removed at compile time. Which
+// instantiation is used is decided once, by select_scan_pol(), before the
+// scan starts.
+template <bool NoDst, bool Stats, bool Filter, bool Hidden, bool MaxDepth,
+          bool NoXdev>
+struct scan_pol_t {
+    static constexpr bool may_no_destin { NoDst };      // --no-dst
+    static constexpr bool may_stats { Stats };          // --statistics
+    // --exclude=, --excl-fn=, --dereference= and --prune=
+    static constexpr bool may_filter { Filter };
+    static constexpr bool may_hidden { Hidden };        // --hidden
+    static constexpr bool may_max_depth { MaxDepth };   // --max-depth=
+    static constexpr bool may_no_xdev { NoXdev };       // --no-xdev
+};
+
+// The common combinations, plus the general one that tests every option
+// at run time. The first is the default: clone /sys to /tmp/sys .
+using scan_pol_def = scan_pol_t<false, false, false, false, false, false>;
+using scan_pol_def_stats = scan_pol_t<false, true, false, false, false, false>;
+using scan_pol_nodst = scan_pol_t<true, false, false, false, false, false>;
+using scan_pol_nodst_stats = scan_pol_t<true, true, false, false, false, false>;
+using scan_pol_gen = scan_pol_t<true, true, true, true, true, true>;
+
+using clone_work_fn_t = std::error_code (*)(const fs::path & src_pt,
+                                            const fs::path & dst_pt,
+                                            const struct opts_t * op);
+using cache_src_fn_t = std::error_code (*)(inmem_dir_t * start_dirp,
+                                           const fs::path & osrc_pt,
+                                           const struct opts_t * op);
+
+// A directory met by the first thread of a parallel pass 1 (--jobs=NJ)
+// whose subtree is left for a worker thread to scan. The node is found via
+// its parent's sub-directory vector since that vector may still grow (and
+// move its elements) until the first thread has finished.
+struct par_unit_t {
+    std::shared_ptr<inmem_subdirs_t> par_sdirs_sp;
+    size_t ind;
+    sstring pt_s;
+    int depth;
+    int cpu;        // >= 0 for tracefs per_cpu/cpuN, scanned pinned to N
+};
+
+// Defaults for a pseudo file system type, chosen by the statfs(2) f_type
+// of SPATH and, for reads, of each file system instance met in the scan
+// (e.g. with --no-xdev). Options given on the command line take
+// precedence. See pfs_prof_tbl[] .
+struct pfs_prof_t {
+    unsigned long f_type;   // magic, see <linux/magic.h>
+    const char * name;      // also accepted by --profile=PNAME
+    unsigned int reglen;    // for --reglen=RLEN
+    int wait_ms;            // for --wait=MS_R, -1 for blocking reads
+    unsigned int jobs;      // for --jobs=NJ, 0 for one per CPU
+    bool no_xdev;           // for --no-xdev
+    bool trace_mode;        // see trace_consuming() and trace_cpu_dir()
+};
+
+// One of the clones done by do_multi_src(), for a --ns-pid=PID or for a
+// line of --batch=BFILE .
+struct multi_src_t {
+    sstring tag;                // names DPATH/tag (--ns-pid), CDIR/tag and
+                                // MFILE.tag
+    sstring label;              // heads the times of this clone
+    fs::path source_pt;
+    fs::path destination_pt;
+};
+
+// With --preserve, the owner, permissions and times of one node, taken from
+// the lstat(2) already done by the source scan. Applied by meta_apply().
+struct meta_rec_t {
+    sstring rel_s;          // path relative to SPATH (and DPATH)
+    int depth;
+    mode_t st_mode;
+    uid_t st_uid;
+    gid_t st_gid;
+    struct timespec st_atim;
+    struct timespec st_mtim;
+};
+
+// With --dedup, the first file placed under DPATH with given contents and
+// permissions. Later files found identical are hard links to it. The
+// contents are kept (in the clone's arena) so a hash collision is not taken
+// as a match. See xfr_vec2file().
+struct dedup_ent_t {
+    sstring d_pt_s;
+    const uint8_t * cp;
+    unsigned int sz;
+    mode_t perms;
+};
+
 struct mut_opts_t {
     bool prune_take_all { };    // for '--src=/sys --prune=/sys'
+    bool pfs_off { };           // --profile=none
     bool clone_work_subseq { };
     bool cache_src_subseq { };
+    bool cache_sorted { };      // --sort : set once sort_cache() has run
+    bool reflink_off { };       // --rollover : FICLONE found unsupported
     size_t starting_src_sz { };
     dev_t starting_fs_inst { };
     inmem_dir_t * cache_rt_dirp { };
+    clone_work_fn_t clone_work_fp { };  // set by select_scan_pol()
+    cache_src_fn_t cache_src_fp { };    // set by select_scan_pol()
     struct stats_t stats { };
     // following two are sorted to enable binary search
     std::vector<sstring> deref_v;
     std::vector<sstring> prune_v;
     std::vector<sstring> glob_exclude_v;  // vector of canonical paths
+    // next two are consumed by the next cache_src() call, see cache_src_par()
+    int scan_depth_base { };    // added to the directory iterator's depth
+    std::vector<par_unit_t> * par_unit_vp { };
+    // file system instance --> its profile (or nullptr), see pfs_prof_dev()
+    std::vector<std::pair<dev_t, const pfs_prof_t *>> dev_prof_v;
+    FILE * dev_mf_fp { };       // --dev-manifest , open while cloning
+    std::vector<meta_rec_t> meta_v;     // --preserve , see meta_apply()
+    // --dedup : cpf_hash::hash64() of contents --> first file holding them
+    std::unordered_map<uint64_t, dedup_ent_t> dedup_m;
+    contents_arena_t * arenap { };  // long cached contents of this clone
+    std::ostream * tm_osp { };  // --ns-pid : times of a PID's clone go here
 };
 
 struct opts_t {
     bool destination_given;
+    bool dev_mf_given;      // -M : device nodes to manifest, not mknod(2)
     bool deref_given;       // one or more --deref= options
     bool exclude_given;     // one or more --exclude= options
     bool excl_fn_given;     // one or more --excl_fn= options
@@ -454,32 +946,62 @@ struct opts_t {
     bool destin_all_new;    // checks for existing can be skipped if all_new
     bool max_depth_active;  // for depth: 0 means one level below source_pt
     bool no_destin;         // -D
+    bool preserve;          // -a : owner, permissions and times to DPATH
     bool clone_hidden;      // copy files starting with '.' (default: don't)
+    bool dedup;             // -u : identical dst files hard linked
+    bool cgroup_given;      // -G : per cgroup harvest instead of a clone
+    bool compact_num;       // -C : integer contents cached as tagged varint
+    bool jobs_given;
+    bool procfs_given;      // -P : PID harvest of procfs instead of a clone
+    bool procfs_task;       // --procfs=...,task : also each thread of a PID
+    bool reglen_given;
+    bool sort_sdirs;        // -O : each directory's contents by filename
     bool no_xdev;           // -N : 'find(1) -xdev' means don't scan outside
                             // original fs so no_xdev is a double negative.
                             // (default for this utility: don't scan outside)
     unsigned int reglen;    // maximum bytes read from regular file
+    unsigned int jobs;      // -j : threads used by pass 1 (def: profile's)
     unsigned int wait_ms;   // to cope with waiting reads (e.g. /proc/kmsg)
+    unsigned int rollover_min;  // --rollover : smaller files not compared
     int cache_op_num;       // -c : cache SPATH to meomory then ...
     int do_extra;           // do more checking and scans
     int max_depth;          // one less than given on command line
     int want_stats;         // should this be the default ? ?
     int verbose;            // make file scope
+    const char * batch_fn;  // --batch=BFILE , SPATH and DPATH per line
+    const char * col_dn;    // --columnar=CDIR , sibling attribute tables
     const char * dst_cli;   // destination given on command line
+    const char * dev_mf_fn;  // --dev-manifest=MFILE
+    const char * log_fn;    // --log=LFILE , pr_err() output to that file
+    const char * prof_cli;  // --profile=PNAME
+    const char * rollover_cli;  // --rollover=PREV
     const char * src_cli;   // source given on command line
+    const char * sqfs_fn;   // --squashfs=SQIMG , image of the cache tree
+    const char * table_fn;  // --table=TFILE , one row per directory
     struct mut_opts_t * mutp;
     fs::path source_pt;         // src root directory in absolute form
     fs::path destination_pt;    // (will be) a directory in canonical form
+    fs::path rollover_pt;       // PREV in canonical form, else empty
     std::shared_ptr<uint8_t[]> reg_buff_sp;
     std::vector<sstring> cl_exclude_v;  // command line --exclude arguments
     std::vector<sstring> excl_fn_v;  // vector of exclude filenames
+    std::vector<sstring> procfs_fset_v;  // --procfs=FSET : per PID files
+    std::vector<sstring> cgroup_fset_v;  // --cgroup=FSET : per cgroup files
+    std::vector<pid_t> ns_pid_v;   // --ns-pid=PID,... : SPATH as PID sees it
 };
 
 static const struct option long_options[] {
+    {"batch", required_argument, 0, 'b'},
     {"cache", no_argument, 0, 'c'},
+    {"cgroup", optional_argument, 0, 'G'},
+    {"columnar", required_argument, 0, 'o'},
+    {"compact", no_argument, 0, 'C'},
+    {"dedup", no_argument, 0, 'u'},
     {"dereference", required_argument, 0, 'R'},
     {"deref", required_argument, 0, 'R'},
     {"destination", required_argument, 0, 'd'},
+    {"dev-manifest", optional_argument, 0, 'M'},
+    {"dev_manifest", optional_argument, 0, 'M'},
     {"dst", required_argument, 0, 'd'},
     {"exclude", required_argument, 0, 'e'},
     {"excl-fn", required_argument, 0, 'E'},
@@ -487,6 +1009,8 @@ static const struct option long_options[] {
     {"extra", no_argument, 0, 'x'},
     {"help", no_argument, 0, 'h'},
     {"hidden", no_argument, 0, 'H'},
+    {"jobs", required_argument, 0, 'j'},
+    {"log", required_argument, 0, 'l'},
     {"max-depth", required_argument, 0, 'm'},
     {"max_depth", required_argument, 0, 'm'},
     {"maxdepth", required_argument, 0, 'm'},
@@ -496,12 +1020,21 @@ static const struct option long_options[] {
     {"no_dst", no_argument, 0, 'D'},
     {"no-xdev", no_argument, 0, 'N'},
     {"no_xdev", no_argument, 0, 'N'},
+    {"ns-pid", required_argument, 0, 'n'},
+    {"ns_pid", required_argument, 0, 'n'},
+    {"preserve", no_argument, 0, 'a'},
+    {"procfs", optional_argument, 0, 'P'},
+    {"profile", required_argument, 0, 'F'},
     {"prune", required_argument, 0, 'p'},
     {"reglen", required_argument, 0, 'r'},
+    {"rollover", required_argument, 0, 'k'},
+    {"sort", no_argument, 0, 'O'},
     {"source", required_argument, 0, 's'},
+    {"squashfs", required_argument, 0, 'i'},
     {"src", required_argument, 0, 's'},
     {"statistics", no_argument, 0, 'S'},
     {"stats", no_argument, 0, 'S'},
+    {"table", required_argument, 0, 'T'},
     {"verbose", no_argument, 0, 'v'},
     {"version", no_argument, 0, 'V'},
     {"wait", required_argument, 0, 'w'},
@@ -511,9 +1044,55 @@ static const struct option long_options[] {
 // directory paths should not have a trailing '/' apart from the root!
 static const sstring sysfs_root { "/sys" };   // default source (normalized)
 static const sstring def_destin_root { "/tmp/sys" };
+static const sstring procfs_root { "/proc" };   // default SPATH for --procfs
+static const sstring def_proc_destin_root { "/tmp/proc" };
+static const unsigned int def_proc_reglen { 4096 };
+static const char * const def_procfs_fset[] { "stat", "status", "cmdline" };
+static const sstring cgroup_root { "/sys/fs/cgroup" };  // for --cgroup
+static const sstring def_cgrp_destin_root { "/tmp/cgroup" };
+static const unsigned int def_cgrp_reglen { 4096 };
+static const size_t col_min_rows { 2 };  // --columnar: siblings per table
+static const int col_sub_depth { 1 };    // sub-directory levels in a row
+static const char * const def_cgroup_fset[] { "cpu.stat", "memory.current",
+                                              "memory.stat", "io.stat",
+                                              "pids.current" };
+
+#ifndef CONFIGFS_MAGIC
+#define CONFIGFS_MAGIC 0x62656570       /* not in all <linux/magic.h> */
+#endif
+
+// Waiting reads (e.g. trace_pipe and the like in tracefs and debugfs) are
+// cut short with a wait of 0 ms. Concurrency is kept to one thread where
+// reads take locks shared by the whole file system (tracefs, debugfs) or
+// where there is little to scan. debugfs allows crossing into tracefs
+// which is automounted at its 'tracing' directory.
+// devtmpfs has the f_type of tmpfs, see pfs_is_devtmpfs() .
+static const pfs_prof_t pfs_prof_tbl[] {
+    // f_type             name       reglen wait_ms jobs no_xdev trace_mode
+    {SYSFS_MAGIC,         "sysfs",     256,   -1,    0,  false,  false},
+    {PROC_SUPER_MAGIC,    "procfs",    256,    0,    0,  false,  false},
+    {TRACEFS_MAGIC,       "tracefs",  4096,    0,    1,  false,  true},
+    {DEBUGFS_MAGIC,       "debugfs",  4096,    0,    1,  true,   false},
+    {CGROUP_SUPER_MAGIC,  "cgroup",   4096,   -1,    0,  false,  false},
+    {CGROUP2_SUPER_MAGIC, "cgroup2",  4096,   -1,    0,  false,  false},
+    {CONFIGFS_MAGIC,      "configfs", 4096,   -1,    1,  false,  false},
+    {TMPFS_MAGIC,         "devtmpfs",  256,   -1,    1,  false,  false},
+};
+
+// tracefs files whose read(2) consumes what it returns, streams, or that
+// are write only. With the tracefs profile they are not read, an empty
+// file stands in for each. The 'trace' and 'snapshot' files give the same
+// data without consuming it. Sorted so binary search can be used.
+static const std::array<std::string_view, 7> trace_consuming_arr {
+    "free_buffer", "snapshot_raw", "trace_marker", "trace_marker_raw",
+    "trace_pipe", "trace_pipe_raw", "user_events_data",
+};
 static const mode_t stat_perm_mask { 0x1ff };         /* bottom 9 bits */
 static const mode_t def_file_perm { S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH };
 static const char * src_symlink_tgt_path { "0_source_symlink_target_path" };
+static const char * def_dev_mf_fn { "0_device_manifest" };  // under DPATH
+// with --jobs=NJ the subtrees of directories at this depth go to workers
+static const int par_fan_depth { 1 };
 
 static const auto dir_opt { fs::directory_options::skip_permission_denied };
 
@@ -526,6 +1105,7 @@ static std::error_code cache_src(inmem_dir_t * start_dirp,
 static void prune_prop_dir(const inmem_dir_t * a_dirp,
                            const sstring & s_par_pt_s,
                            bool in_prune, const struct opts_t * op) noexcept;
+static int apply_src_profile(struct opts_t * op) noexcept;
 
 /**
  * @param v - sorted vector instance
@@ -571,23 +1151,112 @@ l(const std::error_code & ec = { })
 
 static inline sstring s(const fs::path & pt) { return pt.string(); }
 
+// Path builder for the source scan loops. Holds an absolute path in one
+// reusable buffer: a component is appended when the scan descends and the
+// path is cut back to a given depth when the scan returns toward its root.
+// After a few nodes the buffer stops growing so there are no per node heap
+// allocations. str() and c_str() can be handed straight to syscalls.
+struct path_bld_t {
+    path_bld_t() = default;
+    explicit path_bld_t(std::string_view base) { reset(base); }
+
+    void reset(std::string_view base)
+    {
+        buf.assign(base);
+        comp_off_v.clear();
+    }
+
+    // Append one path component (no '/' in comp) below the current path.
+    void push(std::string_view comp)
+    {
+        comp_off_v.push_back(buf.size());
+        if (buf.empty() || (buf.back() != '/'))
+            buf.push_back('/');
+        buf.append(comp);
+    }
+
+    void pop() noexcept
+    {
+        if (! comp_off_v.empty()) {
+            buf.resize(comp_off_v.back());
+            comp_off_v.pop_back();
+        }
+    }
+
+    // Keep the base plus the first a_depth components pushed after it
+    void trunc_depth(size_t a_depth) noexcept
+    {
+        if (a_depth < comp_off_v.size()) {
+            buf.resize(comp_off_v[a_depth]);
+            comp_off_v.resize(a_depth);
+        }
+    }
+
+    size_t depth() const noexcept { return comp_off_v.size(); }
+    const sstring & str() const noexcept { return buf; }
+    const char * c_str() const noexcept { return buf.c_str(); }
+
+    sstring buf;
+    std::vector<size_t> comp_off_v;     // buf.size() prior to each push()
+};
+
+// Returns the last component of pt_s as a view into pt_s, so no copy.
+static inline std::string_view
+filename_sv(const sstring & pt_s) noexcept
+{
+    const auto pos { pt_s.rfind('/') };
+
+    return (pos == sstring::npos) ? std::string_view(pt_s)
+                        : std::string_view(pt_s).substr(pos + 1);
+}
+
 
 static const char * const usage_message1 {
-    "Usage: clone_pseudo_fs [--cache] [--dereference=SYML] "
-    "[--destination=DPATH]\n"
-    "                       [--exclude=PATT] [--excl-fn=EFN] [--extra] "
-    "[--help]\n"
-    "                       [--hidden] [--max-depth=MAXD] [--no-dst] "
-    "[--no-xdev]\n"
+    "Usage: clone_pseudo_fs [--batch=BFILE] [--cache] [--cgroup[=FSET]]\n"
+    "                       [--columnar=CDIR] [--compact] [--dedup]\n"
+    "                       [--dereference=SYML] [--destination=DPATH]\n"
+    "                       [--dev-manifest[=MFILE]] [--exclude=PATT]\n"
+    "                       [--excl-fn=EFN] [--extra] [--help] [--hidden]\n"
+    "                       [--jobs=NJ] [--log=LFILE] [--max-depth=MAXD]\n"
+    "                       [--no-dst] [--no-xdev] [--ns-pid=PID[,PID...]]\n"
+    "                       [--preserve] [--procfs[=FSET]] "
+    "[--profile=PNAME]\n"
     "                       [--prune=T_PT] [--reglen=RLEN] "
-    "[--source=SPATH]\n"
-    "                       [--statistics] [--verbose] [--version] "
-    "[--wait=MS_R]\n"
+    "[--rollover=PREV]\n"
+    "                       [--sort] [--source=SPATH] [--squashfs=SQIMG]\n"
+    "                       [--statistics] [--table=TFILE] [--verbose]\n"
+    "                       [--version] [--wait=MS_R]\n"
     "  where:\n"
+    "    --batch=BFILE|-b BFILE    clone each SPATH to its DPATH, one pair "
+    "per\n"
+    "                              line of BFILE, several at a time "
+    "(def:\n"
+    "                              one per CPU, see --jobs)\n"
     "    --cache|-c         first cache SPATH to in-memory tree, then dump "
     "to\n"
     "                       DPATH. If used twice, also cache regular file\n"
     "                       contents\n"
+    "    --cgroup[=FSET]|-G[FSET]    capture each cgroup in cgroupfs (def:\n"
+    "                                /sys/fs/cgroup) rather than clone it. "
+    "FSET\n"
+    "                                is a comma separated list of files to "
+    "take\n"
+    "                                from each cgroup (def: cpu.stat,\n"
+    "                                memory.current,memory.stat,io.stat,\n"
+    "                                pids.current)\n"
+    "    --columnar=CDIR|-o CDIR    write a CSV table in CDIR for each "
+    "group of\n"
+    "                               sibling directories with the same "
+    "attribute\n"
+    "                               names, one row per directory. Implies "
+    "--cache\n"
+    "                               twice\n"
+    "    --compact|-C       with --cache used twice, hold regular file "
+    "contents\n"
+    "                       that are a single integer in a compact form\n"
+    "    --dedup|-u         hard link each regular file under DPATH to an "
+    "earlier\n"
+    "                       one with the same contents and permissions\n"
     "    --dereference=SYML|-R SYML    SYML should be a symlink within "
     "SPATH\n"
     "                                  which will become a directory "
@@ -596,6 +1265,11 @@ static const char * const usage_message1 {
     "    --destination=DPATH|-d DPATH    DPATH is clone destination (def:\n"
     "                                    /tmp/sys (no default if SPATH "
     "given))\n"
+    "    --dev-manifest[=MFILE]|-M[MFILE]    record device nodes in MFILE "
+    "(def:\n"
+    "                                        DPATH/0_device_manifest) rather "
+    "than\n"
+    "                                        make them with mknod(2)\n"
     "    --exclude=PATT|-e PATT    PATT is a glob pattern, matching nodes\n"
     "                              (including directories) in SPATH to be "
     "excluded\n"
@@ -606,6 +1280,17 @@ static const char * const usage_message1 {
     "    --extra|-x         do some extra sanity checking\n"
     "    --help|-h          this usage information\n"
     "    --hidden|-H        clone hidden files (def: ignore them)\n"
+    "    --jobs=NJ|-j NJ    number of threads scanning SPATH in the first "
+    "pass\n"
+    "                       of --cache (def: from SPATH's profile, one "
+    "per\n"
+    "                       CPU for sysfs, procfs and cgroup, else 1) or\n"
+    "                       harvesting with --procfs or --cgroup (def: one "
+    "per\n"
+    "                       CPU). 0 means one per CPU\n"
+    "    --log=LFILE|-l LFILE    send diagnostic (verbose) output to LFILE "
+    "via a\n"
+    "                            background writer thread (def: stderr)\n"
     "    --max-depth=MAXD|-m MAXD    maximum depth of scan (def: 0 which "
     "means\n"
     "                                there is no limit)\n"
@@ -613,6 +1298,30 @@ static const char * const usage_message1 {
     "    --no-xdev|-N       clone of SPATH may span multiple file systems "
     "(def:\n"
     "                       stay in SPATH's containing file system)\n"
+    "    --ns-pid=PID[,PID...]|-n PID[,PID...]    clone SPATH as seen in "
+    "the\n"
+    "                       mount namespace of each PID (e.g. a "
+    "container's)\n"
+    "                       to DPATH/PID, PIDs cloned concurrently "
+    "(def: one\n"
+    "                       thread per PID, see --jobs)\n"
+    "    --preserve|-a      give DPATH nodes the owner (if root), "
+    "permissions and\n"
+    "                       times of SPATH nodes. Implies --cache\n"
+    "    --procfs[=FSET]|-P[FSET]    capture the processes in procfs "
+    "(def:\n"
+    "                                /proc) rather than clone it. FSET is a "
+    "comma\n"
+    "                                separated list of files to take from "
+    "each\n"
+    "                                PID directory (def: stat,status,cmdline)"
+    "\n"
+    "                                'task' in FSET also takes each thread\n"
+    "    --profile=PNAME|-F PNAME    use defaults of PNAME file system "
+    "profile\n"
+    "                                (e.g. sysfs or tracefs) rather than "
+    "that of\n"
+    "                                SPATH. 'none' for no profile\n"
     "    --prune=T_PT|-p T_PT    output will only contain files exactly "
     "matching\n"
     "                            or under T_PT (take path). Symlinks are "
@@ -620,9 +1329,27 @@ static const char * const usage_message1 {
     "    --reglen=RLEN|-r RLEN    maximum length to clone of each regular "
     "file\n"
     "                             (def: 256 bytes)\n"
+    "    --rollover=PREV|-k PREV    PREV is an earlier DPATH, files "
+    "unchanged\n"
+    "                               since share its data (reflink: btrfs, "
+    "XFS)\n"
+    "    --sort|-O          sort each directory's contents by filename "
+    "so the\n"
+    "                       output does not follow source order (implies "
+    "--cache)\n"
     "    --source=SPATH|-s SPATH    SPATH is source for clone (def: /sys)\n"
+    "    --squashfs=SQIMG|-i SQIMG    write the cache tree as a compressed "
+    "SquashFS\n"
+    "                                 image SQIMG rather than to DPATH "
+    "(unless\n"
+    "                                 given). Implies --cache twice\n"
     "    --statistics|-S    gather then output statistics (helpful with "
     "--no-dst)\n"
+    "    --table=TFILE|-T TFILE    with --cgroup write TFILE as CSV, one "
+    "row per\n"
+    "                              cgroup, one column per value (no DPATH "
+    "tree\n"
+    "                              unless --destination= given)\n"
     "    --verbose|-v       increase verbosity\n"
     "    --version|-V       output version string and exit\n"
     "    --wait=MS_R|-w MS_R    MS_R is number of milliseconds to wait on "
@@ -855,6 +1582,209 @@ inmem_fifo_socket_t::debug(const sstring & intro) const noexcept
     pr_err(-1, "  {}\n", "FIFO or socket");
 }
 
+// Compact numeric contents. The tag byte is laid out as:
+//     bits 1,0: 0 -> decimal, 1 -> negative decimal, 2 -> "0x" hex with
+//               lower case digits, 3 -> "0x" hex with upper case digits
+//     bit 2:    trailing newline
+//     bits 7-3: number of digits (1 to 20) so leading zeros are kept
+// The tag is never 0 for an encoded value. The magnitude follows in
+// LEB128 form. Only input that renders back exactly is accepted.
+static constexpr int num_kind_dec { 0 };
+static constexpr int num_kind_neg { 1 };
+static constexpr int num_kind_hex_lc { 2 };
+static constexpr int num_kind_hex_uc { 3 };
+static constexpr uint8_t num_tag_nl { 0x4 };
+
+// Returns true and fills enc if [bp, bp + n) is a single integer,
+// otherwise returns false and leaves enc alone.
+static bool
+num_encode(const uint8_t * bp, size_t n, num_enc_t & enc) noexcept
+{
+    const bool nl { (n > 0) && (bp[n - 1] == '\n') };
+    const size_t e { nl ? (n - 1) : n };
+    size_t k { 0 };
+    int kind { num_kind_dec };
+    uint64_t val { 0 };
+
+    if ((e > 2) && (bp[0] == '0') && (bp[1] == 'x')) {
+        bool lc { };
+        bool uc { };
+
+        k = 2;
+        if ((e - k) > 16)
+            return false;
+        for (size_t j = k; j < e; ++j) {
+            const uint8_t c { bp[j] };
+            unsigned int d;
+
+            if ((c >= '0') && (c <= '9'))
+                d = c - '0';
+            else if ((c >= 'a') && (c <= 'f')) {
+                d = 10 + c - 'a';
+                lc = true;
+            } else if ((c >= 'A') && (c <= 'F')) {
+                d = 10 + c - 'A';
+                uc = true;
+            } else
+                return false;
+            val = (val << 4) | d;
+        }
+        if (lc && uc)
+            return false;
+        kind = uc ? num_kind_hex_uc : num_kind_hex_lc;
+    } else {
+        if ((e > 0) && (bp[0] == '-')) {
+            k = 1;
+            kind = num_kind_neg;
+        }
+        if ((e <= k) || ((e - k) > 20))
+            return false;
+        for (size_t j = k; j < e; ++j) {
+            const uint8_t c { bp[j] };
+
+            if ((c < '0') || (c > '9'))
+                return false;
+            if (__builtin_mul_overflow(val, 10U, &val) ||
+                __builtin_add_overflow(val, c - '0', &val))
+                return false;
+        }
+    }
+    uint8_t * p { enc.data() };
+
+    *p++ = static_cast<uint8_t>(((e - k) << 3) | (nl ? num_tag_nl : 0) |
+                                kind);
+    do {
+        const uint8_t b { static_cast<uint8_t>(val & 0x7f) };
+
+        val >>= 7;
+        *p++ = val ? (b | 0x80) : b;
+    } while (val);
+    return true;
+}
+
+// Returns the magnitude held in enc (after its tag byte)
+static uint64_t
+num_decode(const num_enc_t & enc) noexcept
+{
+    uint64_t val { 0 };
+
+    for (size_t j = 1, shift = 0; j < enc.size(); ++j, shift += 7) {
+        val |= static_cast<uint64_t>(enc[j] & 0x7f) << shift;
+        if (! (enc[j] & 0x80))
+            break;
+    }
+    return val;
+}
+
+// Writes the original bytes to a_bp which should be at least
+// num_render_max bytes long. Returns the number of bytes written.
+static size_t
+num_render(const num_enc_t & enc, uint8_t * a_bp) noexcept
+{
+    static const char * const lc_digits { "0123456789abcdef" };
+    static const char * const uc_digits { "0123456789ABCDEF" };
+    const uint8_t tag { enc[0] };
+    const int kind { tag & 0x3 };
+    const unsigned int width { static_cast<unsigned int>(tag >> 3) };
+    const unsigned int base { (kind >= num_kind_hex_lc) ? 16U : 10U };
+    const char * digits { (kind == num_kind_hex_uc) ? uc_digits : lc_digits };
+    uint64_t val { num_decode(enc) };
+    uint8_t * p { a_bp };
+
+    if (kind == num_kind_neg)
+        *p++ = '-';
+    else if (base == 16) {
+        *p++ = '0';
+        *p++ = 'x';
+    }
+    // width is the parsed digit count so the value always fits in it
+    for (unsigned int j = width; j > 0; --j) {
+        p[j - 1] = digits[val % base];
+        val /= base;
+    }
+    p += width;
+    if (tag & num_tag_nl)
+        *p++ = '\n';
+    return p - a_bp;
+}
+
+const uint8_t *
+contents_arena_t::store(const uint8_t * bp, size_t n) noexcept
+{
+    if (tl_id != id) {      // last used with another arena
+        tl_id = id;
+        tl_left = 0;
+    }
+    if (n > tl_left) {
+        // a blob bigger than a quarter chunk gets a block to itself
+        const size_t c_sz { (n > (chunk_sz / 4)) ? n : chunk_sz };
+        uint8_t * cp;
+
+        try {
+            auto up { std::make_unique_for_overwrite<uint8_t[]>(c_sz) };
+
+            cp = up.get();
+            std::lock_guard<std::mutex> lk { chunk_mtx };
+            chunk_v.push_back(std::move(up));
+        }
+        catch (...) {
+            return nullptr;
+        }
+        if (c_sz == n) {
+            memcpy(cp, bp, n);
+            return cp;
+        }
+        tl_next = cp;
+        tl_left = c_sz;
+    }
+    uint8_t * res { tl_next };
+
+    memcpy(res, bp, n);
+    tl_next += n;
+    tl_left -= n;
+    return res;
+}
+
+bool
+inmem_contents_t::assign(const uint8_t * bp, size_t n,
+                         contents_arena_t & arena) noexcept
+{
+    if (n <= inl_max) {
+        if (n > 0)
+            memcpy(u.inl, bp, n);
+    } else {
+        u.ext = arena.store(bp, n);
+        if (u.ext == nullptr) {
+            sz = 0;
+            return false;
+        }
+    }
+    sz = static_cast<uint32_t>(n);
+    return true;
+}
+
+std::span<const uint8_t>
+inmem_regular_t::get_contents(uint8_t * a_bp) const noexcept
+{
+    if (is_numeric())
+        return { a_bp, num_render(num_enc, a_bp) };
+    return contents;
+}
+
+bool
+inmem_regular_t::get_numeric(uint64_t & val, bool & negative) const noexcept
+{
+    num_enc_t enc;
+
+    if (is_numeric())
+        enc = num_enc;
+    else if (! num_encode(contents.data(), contents.size(), enc))
+        return false;
+    val = num_decode(enc);
+    negative = ((enc[0] & 0x3) == num_kind_neg);
+    return true;
+}
+
 void
 inmem_regular_t::debug(const sstring & intro) const noexcept
 {
@@ -862,10 +1792,18 @@ inmem_regular_t::debug(const sstring & intro) const noexcept
     pr_err(-1, "  regular file:\n");
     if (read_found_nothing)
         pr_err(-1, "  read of contents found nothing\n");
-    else if (contents.empty())
+    else if (is_numeric()) {
+        uint64_t val { };
+        bool neg { };
+
+        get_numeric(val, neg);
+        pr_err(-1, "  compact numeric: {}{} (tag: 0x{:x})\n", neg ? "-" : "",
+               val, num_enc[0]);
+    } else if (contents.empty())
         pr_err(-1, "  empty\n");
     else
         pr_err(-1, "  file is {} bytes long\n", contents.size());
+    pr_err(-1, "  contents hash: 0x{:016x}\n", contents_hash);
 }
 
 // inmem_t is derived from inm_var_t which is a std::variant of file_types
@@ -911,148 +1849,406 @@ find_in_sorted_vec(std::vector<sstring> & vec, const sstring & pt,
     return res;
 }
 
-// This assumes both paths are in canonical form. Will still work if
-// needle_c_pt is in absolute form (e.g. when needle_c_pt is the link
-// path of a symlink).
+// Path scanning primitives used by path_contains_canon(), split_path()
+// and path_depth(). On x86_64 SSE2 is always available and AVX2 is used
+// when the CPU supports it; the choice is made once, before main() runs.
+// Other architectures get the scalar versions.
+struct path_simd_t {
+    // returns pointer to first '/' in [p, end) or end if there is none
+    const char * (*find_slash)(const char * p, const char * end) noexcept;
+    size_t (*count_slash)(const char * p, const char * end) noexcept;
+    bool (*prefix_eq)(const char * a, const char * b, size_t n) noexcept;
+    const char * name;
+};
+
+static const char *
+find_slash_scalar(const char * p, const char * end) noexcept
+{
+    for ( ; p < end; ++p) {
+        if (*p == '/')
+            break;
+    }
+    return p;
+}
+
+static size_t
+count_slash_scalar(const char * p, const char * end) noexcept
+{
+    size_t res { 0 };
+
+    for ( ; p < end; ++p)
+        res += (*p == '/');
+    return res;
+}
+
 static bool
-path_contains_canon(const fs::path & haystack_c_pt,
-                    const fs::path & needle_c_pt) noexcept
+prefix_eq_scalar(const char * a, const char * b, size_t n) noexcept
 {
-    auto hay_c_sz { s(haystack_c_pt).size() };
-    auto need_c_sz { s(needle_c_pt).size() };
+    return 0 == memcmp(a, b, n);
+}
 
-    if (need_c_sz == hay_c_sz)
-        return needle_c_pt == haystack_c_pt;
-    else if (need_c_sz < hay_c_sz)
-        return false;
+#if defined(__x86_64__)
 
-    auto c_need { needle_c_pt };        // since while loop modifies c_need
+static const char *
+find_slash_sse2(const char * p, const char * end) noexcept
+{
+    const __m128i sl { _mm_set1_epi8('/') };
 
-    do {
-        // step needle back to its parent
-        c_need = c_need.parent_path();
-        need_c_sz = s(c_need).size();
-    } while (need_c_sz > hay_c_sz);
+    for ( ; (end - p) >= 16; p += 16) {
+        const __m128i v
+                { _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)) };
+        const unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, sl));
 
-    if (need_c_sz < hay_c_sz)
-        return false;
-    return c_need == haystack_c_pt;
+        if (m)
+            return p + std::countr_zero(m);
+    }
+    return find_slash_scalar(p, end);
 }
 
-static void
-reg_s_err_stats(int err, struct stats_t * q) noexcept
+static size_t
+count_slash_sse2(const char * p, const char * end) noexcept
 {
-    if (err == EACCES)
-        ++q->num_reg_s_eacces;
-    else if (err == EPERM)
-        ++q->num_reg_s_eperm;
-    else if (err == EIO)
-        ++q->num_reg_s_eio;
-    else if ((err == ENOENT) || (err == ENODEV) || (err == ENXIO))
-        ++q->num_reg_s_enoent_enodev_enxio;
-    else
-        ++q->num_reg_s_e_other;
+    const __m128i sl { _mm_set1_epi8('/') };
+    size_t res { 0 };
+
+    for ( ; (end - p) >= 16; p += 16) {
+        const __m128i v
+                { _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)) };
+
+        res += std::popcount(static_cast<unsigned>(
+                                _mm_movemask_epi8(_mm_cmpeq_epi8(v, sl))));
+    }
+    return res + count_slash_scalar(p, end);
 }
 
-static void
-reg_d_err_stats(int err, struct stats_t * q) noexcept
+static bool
+prefix_eq_sse2(const char * a, const char * b, size_t n) noexcept
 {
-    if (err == EACCES)
-        ++q->num_reg_d_eacces;
-    else if (err == EPERM)
-        ++q->num_reg_d_eperm;
-    else if (err == EIO)
-        ++q->num_reg_d_eio;
-    else if ((err == ENOENT) || (err == ENODEV) || (err == ENXIO))
-        ++q->num_reg_d_enoent_enodev_enxio;
-    else
-        ++q->num_reg_d_e_other;
+    for ( ; n >= 16; a += 16, b += 16, n -= 16) {
+        const __m128i va
+                { _mm_loadu_si128(reinterpret_cast<const __m128i *>(a)) };
+        const __m128i vb
+                { _mm_loadu_si128(reinterpret_cast<const __m128i *>(b)) };
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xffff)
+            return false;
+    }
+    return prefix_eq_scalar(a, b, n);
 }
 
-// Splits the parent path (par_pt_s) into a vector of strings containing the
-// split up path, starting with (but not including) the initial SPATH path
-// (base_pt_s). Those paths should be lexically normal (e.g. no embedded
-// components like 'bus/../devices'). If an error is detected, ec is set.
-static std::vector<sstring>
-split_path(const sstring & par_pt_s, const sstring & base_pt_s,
-           const struct opts_t *op, std::error_code & ec) noexcept
+__attribute__((target("avx2"))) static const char *
+find_slash_avx2(const char * p, const char * end) noexcept
+{
+    const __m256i sl { _mm256_set1_epi8('/') };
+
+    for ( ; (end - p) >= 32; p += 32) {
+        const __m256i v
+                { _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)) };
+        const unsigned m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, sl));
+
+        if (m)
+            return p + std::countr_zero(m);
+    }
+    return find_slash_sse2(p, end);
+}
+
+__attribute__((target("avx2"))) static size_t
+count_slash_avx2(const char * p, const char * end) noexcept
+{
+    const __m256i sl { _mm256_set1_epi8('/') };
+    size_t res { 0 };
+
+    for ( ; (end - p) >= 32; p += 32) {
+        const __m256i v
+                { _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)) };
+
+        res += std::popcount(static_cast<unsigned>(
+                        _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, sl))));
+    }
+    return res + count_slash_sse2(p, end);
+}
+
+__attribute__((target("avx2"))) static bool
+prefix_eq_avx2(const char * a, const char * b, size_t n) noexcept
+{
+    for ( ; n >= 32; a += 32, b += 32, n -= 32) {
+        const __m256i va
+                { _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a)) };
+        const __m256i vb
+                { _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b)) };
+
+        if (static_cast<unsigned>(_mm256_movemask_epi8(
+                        _mm256_cmpeq_epi8(va, vb))) != 0xffffffffU)
+            return false;
+    }
+    return prefix_eq_sse2(a, b, n);
+}
+
+#endif          // __x86_64__
+
+static path_simd_t
+path_simd_select() noexcept
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return { find_slash_avx2, count_slash_avx2, prefix_eq_avx2, "avx2" };
+    return { find_slash_sse2, count_slash_sse2, prefix_eq_sse2, "sse2" };
+#else
+    return { find_slash_scalar, count_slash_scalar, prefix_eq_scalar,
+             "scalar" };
+#endif
+}
+
+static const path_simd_t psimd { path_simd_select() };
+
+// This assumes both paths are in canonical form. Will still work if
+// needle_c is in absolute form (e.g. when needle_c is the link path of a
+// symlink). Contained means needle_c equals haystack_c or starts with
+// haystack_c followed by a '/' .
+static bool
+path_contains_canon(std::string_view haystack_c,
+                    std::string_view needle_c) noexcept
+{
+    const auto hay_c_sz { haystack_c.size() };
+    const auto need_c_sz { needle_c.size() };
+
+    if (hay_c_sz == 0)
+        return need_c_sz == 0;
+    if (need_c_sz < hay_c_sz)
+        return false;
+    if (! psimd.prefix_eq(haystack_c.data(), needle_c.data(), hay_c_sz))
+        return false;
+    if (need_c_sz == hay_c_sz)
+        return true;
+    // prefix matches, it must end on a component boundary
+    return (haystack_c[hay_c_sz - 1] == '/') || (needle_c[hay_c_sz] == '/');
+}
+
+static void
+reg_s_err_stats(int err, struct stats_t * q) noexcept
+{
+    if (err == EACCES)
+        ++q->num_reg_s_eacces;
+    else if (err == EPERM)
+        ++q->num_reg_s_eperm;
+    else if (err == EIO)
+        ++q->num_reg_s_eio;
+    else if ((err == ENOENT) || (err == ENODEV) || (err == ENXIO))
+        ++q->num_reg_s_enoent_enodev_enxio;
+    else
+        ++q->num_reg_s_e_other;
+}
+
+static void
+reg_d_err_stats(int err, struct stats_t * q) noexcept
+{
+    if (err == EACCES)
+        ++q->num_reg_d_eacces;
+    else if (err == EPERM)
+        ++q->num_reg_d_eperm;
+    else if (err == EIO)
+        ++q->num_reg_d_eio;
+    else if ((err == ENOENT) || (err == ENODEV) || (err == ENXIO))
+        ++q->num_reg_d_enoent_enodev_enxio;
+    else
+        ++q->num_reg_d_e_other;
+}
+
+// Returns true if any component of the path in [p, end) is an element of
+// the sorted vector fn_v .
+static bool
+path_comp_in_sorted(const char * p, const char * end,
+                    const std::vector<sstring> & fn_v) noexcept
+{
+    while (p < end) {
+        const char * ep { psimd.find_slash(p, end) };
+
+        if ((ep > p) &&
+            std::ranges::binary_search(fn_v, std::string_view(p, ep - p)))
+            return true;
+        p = ep + 1;
+    }
+    return false;
+}
+
+// Common part of split_path() and path_depth(). On success returns the
+// part of par_pt_s after base_pt_s, which may be empty.
+static std::string_view
+path_below_base(std::string_view par_pt_s, std::string_view base_pt_s,
+                const struct opts_t *op, std::error_code & ec) noexcept
 {
-    std::vector<sstring> res;
-    const char * pp_cp { par_pt_s.c_str() };
     const size_t base_pt_sz { base_pt_s.size() };
-    size_t par_pt_sz { par_pt_s.size() };
+    const size_t par_pt_sz { par_pt_s.size() };
 
     ec.clear();
     if ((base_pt_sz == par_pt_sz) &&
-        (0 == memcmp(base_pt_s.c_str(), pp_cp, par_pt_sz)))
-        return res;
-    if (! path_contains_canon(op->source_pt, par_pt_s)) {
+        psimd.prefix_eq(base_pt_s.data(), par_pt_s.data(), par_pt_sz))
+        return { };
+    if (! path_contains_canon(op->source_pt.native(), par_pt_s)) {
         ec.assign(EDOM, std::system_category());
-        return res;
+        return { };
     }
     if (base_pt_sz == par_pt_sz)
-        return res;
+        return { };
     if (base_pt_sz > par_pt_sz) {
         ec.assign(EINVAL, std::system_category());
-        return res;
+        return { };
     }
-    fs::path pt { pp_cp + base_pt_sz };
-    // iterate over path components. Needs absolute path and '/' is the first
-    // component found (surprisingly), so exclude it from the returned vector
-    for (const auto & comp : pt) {
-        const auto & comp_s { s(comp) };
-        auto sz = comp_s.size();
-        if (sz > 0) {
-            if (comp_s[0] != '/')
-                res.push_back(comp_s);
-        }
+    return par_pt_s.substr(base_pt_sz);
+}
+
+// Splits the parent path (par_pt_s) into a vector of strings containing the
+// split up path, starting with (but not including) the initial SPATH path
+// (base_pt_s). Those paths should be lexically normal (e.g. no embedded
+// components like 'bus/../devices'). If an error is detected, ec is set.
+static std::vector<sstring>
+split_path(std::string_view par_pt_s, std::string_view base_pt_s,
+           const struct opts_t *op, std::error_code & ec) noexcept
+{
+    std::vector<sstring> res;
+    const std::string_view rem { path_below_base(par_pt_s, base_pt_s, op,
+                                                 ec) };
+    const char * p { rem.data() };
+    const char * end { p + rem.size() };
+
+    // empty components (from a leading '/') are skipped
+    while (p < end) {
+        const char * ep { psimd.find_slash(p, end) };
+
+        if (ep > p)
+            res.emplace_back(p, ep - p);
+        p = ep + 1;
     }
     return res;
 }
 
 // This function is the same as split_path() above but instead of
 // returning a vector of path components, it returns the size of
-// that vector. Both functions expect absolute, canonical paths.
+// that vector. Both functions expect absolute, canonical paths, so
+// there are no repeated or trailing '/' characters to allow for.
 static size_t
-path_depth(const sstring & par_pt_s, const sstring & base_pt_s,
+path_depth(std::string_view par_pt_s, std::string_view base_pt_s,
            const struct opts_t *op, std::error_code & ec) noexcept
 {
-    size_t res { 0 };
-    const char * pp_cp { par_pt_s.c_str() };
-    const size_t base_pt_sz { base_pt_s.size() };
-    size_t par_pt_sz { par_pt_s.size() };
+    const std::string_view rem { path_below_base(par_pt_s, base_pt_s, op,
+                                                 ec) };
 
-    ec.clear();
-    if ((base_pt_sz == par_pt_sz) &&
-        (0 == memcmp(base_pt_s.c_str(), pp_cp, par_pt_sz)))
-        return res;
-    if (! path_contains_canon(op->source_pt, par_pt_s)) {
-        ec.assign(EDOM, std::system_category());
-        return res;
+    if (rem.empty())
+        return 0;
+    return psimd.count_slash(rem.data(), rem.data() + rem.size()) +
+           ((rem[0] == '/') ? 0 : 1);
+}
+
+// Returns true if the tmpfs instance dev is mounted as devtmpfs. As
+// statfs(2) gives both the same f_type, look in /proc/self/mountinfo .
+static bool
+pfs_is_devtmpfs(dev_t dev) noexcept
+{
+    std::ifstream ifs("/proc/self/mountinfo");
+    const sstring maj_min { std::to_string(major(dev)) + ':' +
+                            std::to_string(minor(dev)) + ' ' };
+    sstring line;
+
+    // fields: mount_id parent_id major:minor root ... - fstype source ...
+    while (std::getline(ifs, line)) {
+        auto pos { line.find(' ') };
+
+        if (pos != sstring::npos)
+            pos = line.find(' ', pos + 1);
+        if ((pos == sstring::npos) || line.compare(pos + 1, maj_min.size(),
+                                                    maj_min))
+            continue;
+        pos = line.find(" - ", pos);
+        return (pos != sstring::npos) &&
+               (0 == line.compare(pos + 3, 9, "devtmpfs "));
     }
-    if (base_pt_sz == par_pt_sz)
-        return res;
-    if (base_pt_sz > par_pt_sz) {
-        ec.assign(EINVAL, std::system_category());
-        return res;
+    return false;
+}
+
+// Returns the profile of the file system instance dev, of which pt is a
+// member, or nullptr if it has none. Each instance is looked up once and
+// remembered in op->mutp->dev_prof_v .
+static const pfs_prof_t *
+pfs_prof_dev(dev_t dev, const char * pt, const struct opts_t * op) noexcept
+{
+    struct mut_opts_t * omutp { op->mutp };
+    const pfs_prof_t * pp { };
+    struct statfs a_statfs;
+
+    if (omutp->pfs_off)
+        return pp;
+    for (const auto & [a_dev, a_pp] : omutp->dev_prof_v) {
+        if (a_dev == dev)
+            return a_pp;
     }
-    fs::path pt { pp_cp + base_pt_sz };
-    // iterate over path components. Needs absolute path and '/' is the first
-    // component found (surprisingly), so exclude it from the returned vector
-    for (const auto & comp : pt) {
-        const auto & comp_s { s(comp) };
-        auto sz = comp_s.size();
-        if (sz > 0) {
-            if (comp_s[0] != '/')
-                ++res;
+    if (statfs(pt, &a_statfs) == 0) {
+        for (const auto & prof : pfs_prof_tbl) {
+            if (prof.f_type != static_cast<unsigned long>(a_statfs.f_type))
+                continue;
+            if ((prof.f_type != TMPFS_MAGIC) || pfs_is_devtmpfs(dev))
+                pp = &prof;
+            break;
         }
     }
-    return res;
+    omutp->dev_prof_v.emplace_back(dev, pp);
+    if (pp)
+        pr_err(2, "{}: in a {} file system, using its profile{}\n", pt,
+               pp->name, l());
+    return pp;
+}
+
+// Returns the wait, in milliseconds, for reads of files in a file system
+// whose profile is pp (may be nullptr): that of --wait=MS_R if given, else
+// that of the profile. -1 means blocking reads.
+static int
+pfs_wait_ms(const pfs_prof_t * pp, const struct opts_t * op) noexcept
+{
+    if (op->wait_given)
+        return static_cast<int>(op->wait_ms);
+    return pp ? pp->wait_ms : -1;
+}
+
+// Returns true if the regular file pt_s should not be read because it is
+// in tracefs (profile pp) and reading it would consume or stream.
+static inline bool
+trace_consuming(const pfs_prof_t * pp, const sstring & pt_s) noexcept
+{
+    return pp && pp->trace_mode &&
+           std::ranges::binary_search(trace_consuming_arr,
+                                      filename_sv(pt_s));
+}
+
+// Returns N if directory pt_s (in file system instance dev) is a tracefs
+// per_cpu/cpuN directory, else -1 .
+static int
+trace_cpu_dir(const sstring & pt_s, dev_t dev,
+              const struct opts_t * op) noexcept
+{
+    const std::string_view fn { filename_sv(pt_s) };
+    int cpu { -1 };
+
+    if ((fn.size() < 4) || (fn.size() >= pt_s.size()) ||
+        (fn.substr(0, 3) != "cpu"))
+        return -1;
+    const std::string_view par_sv { pt_s.data(),
+                                    pt_s.size() - fn.size() - 1 };
+
+    if (par_sv.substr(par_sv.rfind('/') + 1) != "per_cpu")
+        return -1;
+    const auto [ep, ec] { std::from_chars(fn.data() + 3,
+                                          fn.data() + fn.size(), cpu) };
+    if ((ec != std::errc()) || (ep != (fn.data() + fn.size())))
+        return -1;
+    const pfs_prof_t * pp { pfs_prof_dev(dev, pt_s.c_str(), op) };
+
+    return (pp && pp->trace_mode) ? cpu : -1;
 }
 
-// Returns number of bytes read, -1 for general error, -2 for timeout
+// Returns number of bytes read, -1 for general error, -2 for timeout.
+// wait_ms is from pfs_wait_ms().
 static int
-read_err_wait(int from_fd, uint8_t * bp, int err,
+read_err_wait(int from_fd, uint8_t * bp, int err, int wait_ms,
               const struct opts_t *op) noexcept
 {
     int num { -1 };
@@ -1060,11 +2256,11 @@ read_err_wait(int from_fd, uint8_t * bp, int err,
 
     if (err == EAGAIN) {
         ++q->num_reg_s_eagain;
-        if (op->wait_given) {
+        if (wait_ms >= 0) {
             struct pollfd a_pollfd {0, POLLIN, 0};
 
             a_pollfd.fd = from_fd;
-            int r { poll(&a_pollfd, 1, op->wait_ms) };
+            int r { poll(&a_pollfd, 1, wait_ms) };
             if (r == 0) {
                 ++q->num_reg_s_timeout;
                 return -2;
@@ -1084,24 +2280,102 @@ read_err_wait(int from_fd, uint8_t * bp, int err,
     return num;
 }
 
+// With --rollover=PREV, opens the file at the same path under PREV as
+// destin_file if it holds exactly the num bytes at bp. Returns its file
+// descriptor for FICLONE, else -1 (also when reflinks are off). Files
+// smaller than a DPATH block are not compared: reading the PREV file would
+// cost more than writing them and their reflink saves little.
+static int
+rollover_open(const sstring & destin_file, const uint8_t * bp, int num,
+              const struct opts_t * op) noexcept
+{
+    int fd;
+    int off { };
+    const sstring & d_rt_s { op->destination_pt.native() };
+    struct stat a_stat;
+    uint8_t b[512];
+
+    if (op->mutp->reflink_off || (num <= 0) ||
+        (static_cast<unsigned int>(num) < op->rollover_min) ||
+        (! destin_file.starts_with(d_rt_s)))
+        return -1;
+    fd = open((op->rollover_pt.native() +
+               destin_file.substr(d_rt_s.size())).c_str(),
+              O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;      // e.g. new since PREV
+    if ((fstat(fd, &a_stat) < 0) || (! S_ISREG(a_stat.st_mode)) ||
+        (a_stat.st_size != num))
+        goto changed;
+    while (off < num) {
+        const int n { static_cast<int>(read(fd, b, std::min(
+                        static_cast<int>(sizeof(b)), num - off))) };
+
+        if ((n <= 0) || (memcmp(b, bp + off, n) != 0))
+            goto changed;
+        off += n;
+    }
+    return fd;
+changed:
+    close(fd);
+    return -1;
+}
+
 // Returns 0 on success, else a Unix like errno value is returned.
-// st_mode can be 0 in which case def_file_perm are used.
+// st_mode can be 0 in which case def_file_perm are used. With --dedup,
+// destin_file becomes a hard link to an earlier file with the same
+// contents and permissions, if there is one; v_hash is the hash of v if
+// already known, else 0. With --rollover=PREV, a file unchanged since PREV
+// shares its extents (via FICLONE) rather than being written.
 static int
-xfr_vec2file(const std::vector<uint8_t> & v, const sstring & destin_file,
-             mode_t st_mode, const struct opts_t * op) noexcept
+xfr_vec2file(std::span<const uint8_t> v, const sstring & destin_file,
+             mode_t st_mode, uint64_t v_hash,
+             const struct opts_t * op) noexcept
 {
     int res { };
     int destin_fd { -1 };
     int num { static_cast<int>(v.size()) };
     int num2;
+    int prev_fd { -1 };
     // need S_IWUSR set if non-root and want later overwrite
     mode_t from_perms
         { static_cast<mode_t>((st_mode | def_file_perm) & stat_perm_mask) };
+    bool dedup_add { false };
+    uint64_t h { };
     const uint8_t * bp;
     const char * destin_nm { destin_file.c_str() };
     struct stats_t * q { &op->mutp->stats };
 
-    bp = (v.empty() ? nullptr : &v[0]);
+    bp = (v.empty() ? nullptr : v.data());
+    if (op->dedup) {
+        const auto & m { op->mutp->dedup_m };
+
+        h = v_hash ? v_hash : cpf_hash::hash64(bp, num);
+        const auto it { m.find(h) };
+
+        // do not write through a hard link left by an earlier --dedup
+        if (! op->destin_all_new)
+            unlink(destin_nm);
+        if (it == m.end())
+            dedup_add = true;
+        else if ((it->second.perms == from_perms) &&
+                 (it->second.sz == static_cast<unsigned int>(num)) &&
+                 ((num == 0) || (memcmp(it->second.cp, bp, num) == 0))) {
+            if (linkat(AT_FDCWD, it->second.d_pt_s.c_str(), AT_FDCWD,
+                       destin_nm, 0) == 0) {
+                ++q->num_reg_d_linked;
+                ++q->num_reg_success;
+                return 0;
+            }
+            // e.g. EMLINK: this file is written and later ones link to it
+            ++q->num_reg_d_link_err;
+            pr_err(3, "linkat({}) failed, write instead{}\n", destin_nm,
+                   l(std::error_code(errno, std::system_category())));
+            dedup_add = true;
+        }       // else a hash collision: write, do not replace the entry
+    }
+    if (! op->rollover_pt.empty())
+        prev_fd = rollover_open(destin_file, bp, num, op);
     if (op->destin_all_new) {
         destin_fd = creat(destin_nm, from_perms);
         if (destin_fd < 0) {
@@ -1115,17 +2389,47 @@ xfr_vec2file(const std::vector<uint8_t> & v, const sstring & destin_file,
             goto fini;
         }
     }
+    if (prev_fd >= 0) {
+        if (ioctl(destin_fd, FICLONE, prev_fd) == 0) {
+            ++q->num_reg_d_reflinked;
+            goto dedup_chk;
+        }
+        const int err { errno };
+
+        if ((err == EOPNOTSUPP) || (err == EXDEV) || (err == EINVAL) ||
+            (err == ENOTTY)) {
+            // stays off for the rest of this clone
+            op->mutp->reflink_off = true;
+            pr_err(0, "FICLONE from PREV unsupported, --rollover writes "
+                   "each file{}\n", l(std::error_code(err,
+                                                     std::system_category())));
+        } else
+            ++q->num_reg_d_reflink_err;
+    }
     if (bp && (num > 0)) {
         num2 = write(destin_fd, bp, num);
         if (num2 < 0) {
             reg_d_err_stats(errno, q);
             goto fini;
         }
-        if (num2 < num)
+        if (num2 < num) {
             pr_err(0, "short write() to dst: {}, strange{}\n",
                    destin_nm, l());
+            dedup_add = false;
+        }
+    }
+dedup_chk:
+    if (dedup_add) {
+        const uint8_t * cp { (num > 0) ? op->mutp->arenap->store(bp, num)
+                                       : nullptr };
+
+        if (cp || (num == 0))
+            op->mutp->dedup_m.insert_or_assign(h, dedup_ent_t {destin_file,
+                        cp, static_cast<unsigned int>(num), from_perms});
     }
 fini:
+    if (prev_fd >= 0)
+        close(prev_fd);
     if (destin_fd >= 0)
         close(destin_fd);
     if (res == 0)
@@ -1144,11 +2448,20 @@ xfr_reg_file2inmem(const sstring & from_file, inmem_regular_t & ireg,
     int from_perms, num;
     uint8_t * bp;
     const char * from_nm { from_file.c_str() };
+    const pfs_prof_t * pp { pfs_prof_dev(ireg.shstat.st_dev, from_nm, op) };
+    const int wait_ms { pfs_wait_ms(pp, op) };
     struct stats_t * q { &op->mutp->stats };
     struct stat from_stat;
     uint8_t fix_b[def_reglen];
 
     ++q->num_reg_tries;
+    if (trace_consuming(pp, from_file)) {
+        ++q->num_reg_s_trace_skip;
+        from_perms = ireg.shstat.st_mode & stat_perm_mask;
+        num = 0;
+        bp = fix_b;
+        goto store;
+    }
     if (op->reglen <= def_reglen)
         bp = fix_b;
     else
@@ -1157,7 +2470,7 @@ xfr_reg_file2inmem(const sstring & from_file, inmem_regular_t & ireg,
         ++q->num_reg_s_e_other;
         return ENOMEM;
     }
-    if (op->wait_given && (op->reglen > 0))
+    if ((wait_ms >= 0) && (op->reglen > 0))
         rd_flags |= O_NONBLOCK;
     from_fd = open(from_nm, rd_flags);
     if (from_fd < 0) {
@@ -1188,7 +2501,7 @@ xfr_reg_file2inmem(const sstring & from_file, inmem_regular_t & ireg,
             num = read(from_fd, bp + off, op->reglen - off);
             if (num < 0) {
                 res = errno;
-                num = read_err_wait(from_fd, bp, res, op);
+                num = read_err_wait(from_fd, bp, res, wait_ms, op);
                 if (num < 0) {
                     if (num == -2)
                         pr_err(0, "timed out waiting for this file: {}{}\n",
@@ -1213,9 +2526,18 @@ xfr_reg_file2inmem(const sstring & from_file, inmem_regular_t & ireg,
         ++q->num_reg_s_at_reglen;
 
 store:
+    from_fd = -1;
+    // hash while the bytes are still hot in the read buffer
+    if (op->dedup || op->sqfs_fn)
+        ireg.contents_hash = cpf_hash::hash64(bp, (num > 0) ? num : 0);
     if (num > 0) {
-        std::vector<uint8_t> l_contents(bp, bp + num);
-        ireg.contents.swap(l_contents);
+        if (op->compact_num && num_encode(bp, num, ireg.num_enc))
+            ++q->num_reg_compact;
+        else if (! ireg.contents.assign(bp, num, *op->mutp->arenap)) {
+            res = ENOMEM;
+            ++q->num_reg_s_e_other;
+            goto fini;
+        }
         ireg.read_found_nothing = false;
     } else if (num == 0)
         ireg.read_found_nothing = true;
@@ -1234,8 +2556,43 @@ xfr_reg_inmem2file(const inmem_regular_t & ireg, const sstring & destin_file,
 {
     mode_t from_perms
         { static_cast<mode_t>(ireg.shstat.st_mode & stat_perm_mask) };
+    uint8_t num_b[num_render_max];
+
+    return xfr_vec2file(ireg.get_contents(num_b), destin_file, from_perms,
+                        ireg.contents_hash, op);
+}
+
+// With --dev-manifest, records the device node that would be made at
+// destin_file as a line in MFILE rather than calling mknod(2): its type,
+// major and minor numbers, permissions and path relative to DPATH.
+static void
+dev_manifest_add(const sstring & destin_file, mode_t st_mode, dev_t st_rdev,
+                 const struct opts_t * op) noexcept
+{
+    std::string_view rel_sv { destin_file };
+
+    if (rel_sv.starts_with(op->destination_pt.native()))
+        rel_sv.remove_prefix(op->destination_pt.native().size());
+    while (rel_sv.starts_with('/'))
+        rel_sv.remove_prefix(1);
+    fprintf(op->mutp->dev_mf_fp, "%c %u %u %04o %.*s\n",
+            S_ISBLK(st_mode) ? 'b' : 'c', major(st_rdev), minor(st_rdev),
+            static_cast<unsigned int>(st_mode & stat_perm_mask),
+            static_cast<int>(rel_sv.size()), rel_sv.data());
+    ++op->mutp->stats.num_dev_manifest;
+}
+
+// Opens mf_s as the --dev-manifest file, writing its header line. Returns
+// nullptr (with errno set) on failure.
+static FILE *
+dev_manifest_open(const sstring & mf_s, const struct opts_t * op) noexcept
+{
+    FILE * fp { fopen(mf_s.c_str(), "w") };
 
-    return xfr_vec2file(ireg.contents, destin_file, from_perms, op);
+    if (fp)
+        fprintf(fp, "# type major minor mode path (under %s)\n",
+                op->destination_pt.c_str());
+    return fp;
 }
 
 // N.B. Only root can successfully invoke the mknod(2) system call
@@ -1246,6 +2603,14 @@ xfr_dev_inmem2file(const inmem_device_t & idev, const sstring & destin_file,
     int res { };
     struct stats_t * q { &op->mutp->stats };
 
+    if (op->mutp->dev_mf_fp) {
+        dev_manifest_add(destin_file, idev.shstat.st_mode, idev.st_rdev, op);
+        if (idev.is_block_dev)
+            ++q->num_block;
+        else
+            ++q->num_char;
+        return 0;
+    }
     if (mknod(destin_file.c_str(), idev.shstat.st_mode, idev.st_rdev) < 0) {
         res = errno;
         if (res == EACCES)
@@ -1265,7 +2630,8 @@ xfr_dev_inmem2file(const inmem_device_t & idev, const sstring & destin_file,
 
 // Returns 0 on success, else a Unix like errno value is returned.
 static int
-xfr_reg_file2file(const sstring & from_file, const sstring & destin_file,
+xfr_reg_file2file(const sstring & from_file, dev_t from_dev,
+                  const sstring & destin_file,
                   const struct opts_t * op) noexcept
 {
     int res { 0 };
@@ -1275,11 +2641,23 @@ xfr_reg_file2file(const sstring & from_file, const sstring & destin_file,
     mode_t from_perms;
     uint8_t * bp;
     const char * from_nm { from_file.c_str() };
+    const pfs_prof_t * pp { pfs_prof_dev(from_dev, from_nm, op) };
+    const int wait_ms { pfs_wait_ms(pp, op) };
     struct stats_t * q { &op->mutp->stats };
     struct stat from_stat;
     uint8_t fix_b[def_reglen];
 
     ++q->num_reg_tries;
+    if (trace_consuming(pp, from_file)) {
+        ++q->num_reg_s_trace_skip;
+        if (stat(from_nm, &from_stat) < 0) {
+            res = errno;
+            reg_s_err_stats(res, q);
+            goto fini;
+        }
+        from_perms = from_stat.st_mode & stat_perm_mask;
+        goto do_destin;
+    }
     if (op->reglen <= def_reglen)
         bp = fix_b;
     else
@@ -1288,7 +2666,7 @@ xfr_reg_file2file(const sstring & from_file, const sstring & destin_file,
         ++q->num_reg_s_e_other;
         return ENOMEM;
     }
-    if (op->wait_given && (op->reglen > 0))
+    if ((wait_ms >= 0) && (op->reglen > 0))
         rd_flags |= O_NONBLOCK;
     from_fd = open(from_nm, rd_flags);
     if (from_fd < 0) {
@@ -1318,7 +2696,7 @@ xfr_reg_file2file(const sstring & from_file, const sstring & destin_file,
             num = read(from_fd, bp + off, op->reglen - off);
             if (num < 0) {
                 res = errno;
-                num = read_err_wait(from_fd, bp, res, op);
+                num = read_err_wait(from_fd, bp, res, wait_ms, op);
                 if (num < 0) {
                     if (num == -2)
                         pr_err(0, "timed out waiting for this file: {}{}\n",
@@ -1345,10 +2723,10 @@ do_destin:
     if (num >= 0) {
         if (num > 0)
             res = xfr_vec2file(std::vector<uint8_t>(bp, bp + num),
-                               destin_file, from_perms, op);
+                               destin_file, from_perms, 0, op);
         else
             res = xfr_vec2file(std::vector<uint8_t>(), destin_file,
-                               from_perms, op);
+                               from_perms, 0, op);
     }
 fini:
     if (from_fd >= 0)
@@ -1357,8 +2735,8 @@ fini:
 }
 
 static std::error_code
-xfr_other_ft(fs::file_type ft, const fs::path & src_pt,
-             const struct stat & src_stat, const fs::path & dst_pt,
+xfr_other_ft(fs::file_type ft, const sstring & src_pt,
+             const struct stat & src_stat, const sstring & dst_pt,
              const struct opts_t * op) noexcept
 {
     int res { };
@@ -1366,29 +2744,33 @@ xfr_other_ft(fs::file_type ft, const fs::path & src_pt,
     struct stats_t * q { &op->mutp->stats };
 
     pr_err(3, "{}: ft={}, src_pt: {}, dst_pt: {}\n", __func__,
-           static_cast<int>(ft), s(src_pt), s(dst_pt));
+           static_cast<int>(ft), src_pt, dst_pt);
     switch (ft) {
     using enum fs::file_type;
 
     case regular:
-        res = xfr_reg_file2file(src_pt, dst_pt, op);
+        res = xfr_reg_file2file(src_pt, src_stat.st_dev, dst_pt, op);
         if (res) {
             ec.assign(res, std::system_category());
-            pr_err(3, "{} --> {}: xfr_reg_file2file() failed{}\n", s(src_pt),
-                   s(dst_pt), l(ec));
+            pr_err(3, "{} --> {}: xfr_reg_file2file() failed{}\n", src_pt,
+                   dst_pt, l(ec));
             ++q->num_error;
         } else
-            pr_err(5, "{} --> {}: xfr_reg_file2file() ok{}\n", s(src_pt),
-                   s(dst_pt), l(ec));
+            pr_err(5, "{} --> {}: xfr_reg_file2file() ok{}\n", src_pt,
+                   dst_pt, l(ec));
         break;
     case block:
     case character:
+        if (op->mutp->dev_mf_fp) {
+            dev_manifest_add(dst_pt, src_stat.st_mode, src_stat.st_rdev, op);
+            break;
+        }
         // N.B. Only root can successfully invoke the mknod(2) system call
         if (mknod(dst_pt.c_str(), src_stat.st_mode,
                   src_stat.st_rdev) < 0) {
             res = errno;
             ec.assign(res, std::system_category());
-            pr_err(3, "{} --> {}: mknod() failed{}\n", s(src_pt), s(dst_pt),
+            pr_err(3, "{} --> {}: mknod() failed{}\n", src_pt, dst_pt,
                    l(ec));
             if (res == EACCES)
                 ++q->num_mknod_d_eacces;
@@ -1397,15 +2779,15 @@ xfr_other_ft(fs::file_type ft, const fs::path & src_pt,
             else
                 ++q->num_mknod_d_fail;
         } else
-            pr_err(5, "{} --> {}: mknod() ok{}\n", s(src_pt), s(dst_pt));
+            pr_err(5, "{} --> {}: mknod() ok{}\n", src_pt, dst_pt);
         break;
     case fifo:
         pr_err(0, "source: {}; file type: fifo not supported{}\n",
-               s(src_pt), l());
+               src_pt, l());
         break;
     case socket:
         pr_err(0, "source: {}; file type: socket not supported{}\n",
-               s(src_pt), l());
+               src_pt, l());
         break;              // skip these file types
     default:                // here when something no longer exists
         pr_err(3, "unexpected file_type={}{}\n", static_cast<int>(ft),
@@ -1482,6 +2864,44 @@ show_stats(const struct opts_t * op) noexcept
     struct stats_t * q { &op->mutp->stats };
 
     scout << "Statistics:\n";
+    if (op->procfs_given) {
+        scout << "Number of processes: " << q->num_proc_pid << "\n";
+        if (op->procfs_task)
+            scout << "Number of threads: " << q->num_proc_tid << "\n";
+        scout << "Number of processes gone before harvested: "
+              << q->num_proc_gone << "\n";
+        scout << "Number of files harvested: " << q->num_proc_file << "\n";
+        scout << "Number of files unreadable: " << q->num_proc_file_err
+              << "\n";
+        if (extra)
+            scout << "Number of files at reglen: " << q->num_reg_s_at_reglen
+                  << "\n";
+        if (! op->no_destin) {
+            scout << "Number of dst created directories: "
+                  << q->num_dir_d_success << "\n";
+            scout << "Number of dst files written: " << q->num_reg_success
+                  << "\n";
+        }
+        return;
+    }
+    if (op->cgroup_given) {
+        scout << "Number of cgroups: " << q->num_cgrp_dir << "\n";
+        scout << "Number of cgroups gone before harvested: "
+              << q->num_cgrp_gone << "\n";
+        scout << "Number of files harvested: " << q->num_cgrp_file << "\n";
+        scout << "Number of files unreadable: " << q->num_cgrp_file_err
+              << "\n";
+        if (extra)
+            scout << "Number of files at reglen: " << q->num_reg_s_at_reglen
+                  << "\n";
+        if (! op->no_destin) {
+            scout << "Number of dst created directories: "
+                  << q->num_dir_d_success << "\n";
+            scout << "Number of dst files written: " << q->num_reg_success
+                  << "\n";
+        }
+        return;
+    }
     scout << "Number of nodes: " << q->num_node << "\n";
     scout << "Number of regular files: " << q->num_regular << "\n";
     scout << "Number of directories: " << q->num_dir << "\n";
@@ -1543,6 +2963,15 @@ show_stats(const struct opts_t * op) noexcept
             scout << "Number of dst mknod other failures: "
                   << q->num_mknod_d_fail << "\n";
         }
+        if (op->dev_mf_given)
+            scout << "Number of device nodes in manifest: "
+                  << q->num_dev_manifest << "\n";
+        if (op->preserve) {
+            scout << "Number of dst nodes given source metadata: "
+                  << q->num_meta_set << "\n";
+            scout << "Number of dst metadata errors: " << q->num_meta_err
+                  << "\n";
+        }
         if (op->deref_given)
             scout << "Number of follow symlinks outside subtree: "
                   << q->num_follow_sym_outside << "\n";
@@ -1605,6 +3034,41 @@ show_stats(const struct opts_t * op) noexcept
     }
     scout << "Number of files " << op->reglen << " bytes or longer: "
           << q->num_reg_s_at_reglen << "\n";
+    if (op->compact_num)
+        scout << "Number of files cached in compact numeric form: "
+              << q->num_reg_compact << "\n";
+    if (q->num_reg_s_trace_skip)
+        scout << "Number of tracefs consuming files not read: "
+              << q->num_reg_s_trace_skip << "\n";
+    if (op->dedup) {
+        scout << "Number of dst files hard linked to identical ones: "
+              << q->num_reg_d_linked << "\n";
+        if (q->num_reg_d_link_err)
+            scout << "Number of dst linkat(2) errors (file written): "
+                  << q->num_reg_d_link_err << "\n";
+    }
+    if (! op->rollover_pt.empty()) {
+        scout << "Number of dst files reflinked to unchanged PREV ones: "
+              << q->num_reg_d_reflinked << "\n";
+        if (q->num_reg_d_reflink_err)
+            scout << "Number of dst FICLONE errors (file written): "
+                  << q->num_reg_d_reflink_err << "\n";
+    }
+    if (op->col_dn) {
+        scout << "Number of columnar tables written: " << q->num_col_table
+              << "\n";
+        scout << "Number of columnar rows written: " << q->num_col_row
+              << "\n";
+        if (q->num_col_err)
+            scout << "Number of columnar table errors: " << q->num_col_err
+                  << "\n";
+    }
+    if (op->sqfs_fn) {
+        scout << "Number of SquashFS image inodes: " << q->num_sqfs_inode
+              << "\n";
+        scout << "Number of SquashFS files sharing identical data: "
+              << q->num_sqfs_shared << "\n";
+    }
 }
 
 static fs::path
@@ -1648,8 +3112,8 @@ read_symlink(const fs::path & pt, const struct opts_t * op,
 // Returns pair <error_code ec, bool serious>. If ec is true (holds error)
 // caller should only consider it serious if that (second) flag is true.
 static std::pair<std::error_code, bool>
-symlink_clone_work(const fs::path & pt, const fs::path & prox_pt,
-                   const fs::path & ongoing_d_pt, bool deref_entry,
+symlink_clone_work(const fs::path & pt, std::string_view prox_sv,
+                   const sstring & d_lnk_s, bool deref_entry,
                    const struct opts_t * op) noexcept
 {
     std::error_code ec { };
@@ -1658,33 +3122,24 @@ symlink_clone_work(const fs::path & pt, const fs::path & prox_pt,
 
     if (ec)
         return {ec, false};
-    fs::path d_lnk_pt { prox_pt / pt.filename() };
     if (! op->destin_all_new) {     /* may already exist */
-        const auto d_lnk_ftype { fs::symlink_status(d_lnk_pt, ec).type() };
+        struct stat d_lnk_stat;
 
-        if (ec) {
-            int v { ec.value() };
+        if (lstat(d_lnk_s.c_str(), &d_lnk_stat) < 0) {
+            int v { errno };
 
-            // ENOENT can happen with "dynamic" sysfs
-            if (v == ENOENT) {
-                ++q->num_sym_s_enoent;
-                pr_err(4, "{}: symlink_status() failed{}\n", s(d_lnk_pt),
-                       l(ec));
-            } else {
+            if (v != ENOENT) {
+                ec.assign(v, std::system_category());
                 ++q->num_sym_s_dangle;
-                pr_err(2, "{}: symlink_status() failed{}\n", s(d_lnk_pt),
-                       l(ec));
-            }
-            return {ec, false};
-        }
-        if (d_lnk_ftype == fs::file_type::symlink)
+                pr_err(2, "{}: lstat() failed{}\n", d_lnk_s, l(ec));
+                return {ec, false};
+            }       // ENOENT: drop through
+        } else if (S_ISLNK(d_lnk_stat.st_mode))
             return {ec, false};
-        else if (d_lnk_ftype == fs::file_type::not_found)
-            ;       // drop through
-        else if (deref_entry && (d_lnk_ftype == fs::file_type::directory))
+        else if (deref_entry && S_ISDIR(d_lnk_stat.st_mode))
             return {ec, false};  // skip because destination is already dir
         else {
-            pr_err(-1, "{}: unexpected d_lnk_ftype{}\n", s(d_lnk_pt), l(ec));
+            pr_err(-1, "{}: unexpected d_lnk_ftype{}\n", d_lnk_s, l());
             ++q->num_error;
             return {ec, false};
         }
@@ -1699,7 +3154,8 @@ symlink_clone_work(const fs::path & pt, const fs::path & prox_pt,
             ++q->num_sym_s_dangle;
             return {ec, false};
         }
-        if (! path_contains_canon(op->source_pt, canon_s_sl_targ_pt)) {
+        if (! path_contains_canon(op->source_pt.native(),
+                                  canon_s_sl_targ_pt.native())) {
             ++q->num_follow_sym_outside;
             pr_err(0, "{}: outside, fall back to symlink{}\n",
                    s(canon_s_sl_targ_pt), l());
@@ -1716,37 +3172,47 @@ symlink_clone_work(const fs::path & pt, const fs::path & prox_pt,
         if (s_targ_ftype == fs::file_type::directory) {
             // create dir when src is symlink and follow active
             // no problem if already exists
+            const fs::path d_lnk_pt { d_lnk_s };
+
             fs::create_directory(d_lnk_pt, ec);
             if (ec) {
-                pr_err(0, "{}: create_directory() failed{}\n", s(d_lnk_pt),
+                pr_err(0, "{}: create_directory() failed{}\n", d_lnk_s,
                        l(ec));
                 ++q->num_dir_d_fail;
                 return {ec, false};
             }
-            const fs::path deep_d_pt { ongoing_d_pt / d_lnk_pt };
             const auto d_sl_tgt { d_lnk_pt / src_symlink_tgt_path };
             const auto ctspt { s(canon_s_sl_targ_pt) + "\n" };
             const char * ccp { ctspt.c_str() };
             const uint8_t * bp { reinterpret_cast<const uint8_t *>(ccp) };
             std::vector<uint8_t> v(bp, bp + ctspt.size());
 
-            int res = xfr_vec2file(v, d_sl_tgt, 0, op);
+            int res = xfr_vec2file(v, d_sl_tgt, 0, 0, op);
             if (res) {
                 ec.assign(res, std::system_category());
                 pr_err(3, "{}: xfr_vec2file() failed{}\n", s(d_sl_tgt),
                        l(ec));
                 ++q->num_error;
             }
-            ec = clone_work(canon_s_sl_targ_pt, deep_d_pt, op);
+            ec = clone_work(canon_s_sl_targ_pt, d_lnk_pt, op);
             if (ec) {
                 pr_err(-1, "{}: clone_work() failed{}\n",
                        s(canon_s_sl_targ_pt), l(ec));
                 return {ec, true};
             }
         } else if (s_targ_ftype == fs::file_type::regular) {
-            struct stat src_stat { };       // not needed for reg->reg
-            ec = xfr_other_ft(fs::file_type::regular, canon_s_sl_targ_pt,
-                              src_stat, d_lnk_pt, op);
+            // st_dev selects the target's file system profile
+            struct stat src_stat;
+
+            if (stat(canon_s_sl_targ_pt.c_str(), &src_stat) < 0) {
+                ec.assign(errno, std::system_category());
+                pr_err(0, "{}: stat() failed{}\n", s(canon_s_sl_targ_pt),
+                       l(ec));
+                ++q->num_error;
+                return {ec, false};
+            }
+            ec = xfr_other_ft(fs::file_type::regular, s(canon_s_sl_targ_pt),
+                              src_stat, d_lnk_s, op);
             ec.clear();
         } else {
             pr_err(0, "{}: deref other than sl->dir or sl->reg, fall back "
@@ -1756,17 +3222,16 @@ symlink_clone_work(const fs::path & pt, const fs::path & prox_pt,
         return {ec, false};
     }               // end of id (deref_entry)
 process_as_symlink:
-    fs::create_symlink(target_pt, d_lnk_pt, ec);
-    if (ec) {
-        pr_err(0, "{} --> {}: create_symlink() failed\n", s(d_lnk_pt),
+    if (symlink(target_pt.c_str(), d_lnk_s.c_str()) < 0) {
+        ec.assign(errno, std::system_category());
+        pr_err(0, "{} --> {}: symlink() failed{}\n", d_lnk_s,
                s(target_pt), l(ec));
         ++q->num_error;
     } else {
         ++q->num_sym_d_success;
-        pr_err(4, "{} --> {}: create_symlink() ok\n", s(d_lnk_pt),
-               s(target_pt), l());
+        pr_err(4, "{} --> {}: symlink() ok{}\n", d_lnk_s, s(target_pt), l());
         if (op->do_extra > 0) {
-            fs::path abs_target_pt { prox_pt / target_pt };
+            fs::path abs_target_pt { fs::path(prox_sv) / target_pt };
             if (fs::exists(abs_target_pt, ec))
                 pr_err(4, "{}: symlink target exists{}\n", s(abs_target_pt),
                        l());
@@ -1781,86 +3246,122 @@ process_as_symlink:
     return {ec, false};
 }
 
+template <typename P>
 static void
-dir_clone_work(const fs::path & pt, fs::recursive_directory_iterator & itr,
-               dev_t st_dev, fs::perms s_perms, const fs::path & ongoing_d_pt,
+dir_clone_work(const sstring & pt_s, fs::recursive_directory_iterator & itr,
+               const struct stat & src_stat, const sstring & ongoing_d_s,
                const struct opts_t * op, std::error_code & ec) noexcept
 {
     struct stats_t * q { &op->mutp->stats };
 
-    if (! op->no_xdev) { // double negative ...
-        if (st_dev != op->mutp->starting_fs_inst) {
+    if (! (P::may_no_xdev && op->no_xdev)) { // double negative ...
+        if (src_stat.st_dev != op->mutp->starting_fs_inst) {
             // do not visit this sub-branch: different fs instance
             pr_err(1, "Source trying to leave this fs instance at: {}\n",
-                   s(pt));
+                   pt_s);
             itr.disable_recursion_pending();
             ++q->num_oth_fs_skipped;
         }
     }
     if (! op->destin_all_new) { /* may already exist */
-        if (fs::exists(ongoing_d_pt, ec)) {
-            if (fs::is_directory(ongoing_d_pt, ec)) {
+        struct stat d_stat;
+
+        if (stat(ongoing_d_s.c_str(), &d_stat) == 0) {
+            if (S_ISDIR(d_stat.st_mode))
                 ++q->num_dir_d_exists;
-            } else if (ec) {
-                pr_err(-1, "is_directory({}) failed\n", s(ongoing_d_pt),
-                       l(ec));
-                ++q->num_error;
-            } else
+            else
                 pr_err(0, "{}: exists but not directory, skip{}\n",
-                       s(ongoing_d_pt), l());
+                       ongoing_d_s, l());
             return;
-        } else if (ec) {
-            pr_err(-1, "{}: exists() failed{}\n", s(ongoing_d_pt), l(ec));
+        } else if (errno != ENOENT) {
+            ec.assign(errno, std::system_category());
+            pr_err(-1, "{}: stat() failed{}\n", ongoing_d_s, l(ec));
             ++q->num_error;
             return;
         } else {
-            ;   // drop through to create_dir
+            ;   // drop through to mkdir
         }
     }
-    if (fs::create_directory(ongoing_d_pt, pt, ec)) {
-        const fs::perms s_pms = s_perms;
-        if ((s_pms & fs::perms::owner_write) != fs::perms::owner_write) {
-            // if source directory doesn't have owner_write then
-            // make sure destination does.
-            fs::permissions(ongoing_d_pt, fs::perms::owner_write,
-                            fs::perm_options::add, ec);
-            if (ec) {
-                pr_err(-1, "{}: couldn't add owner_write perm{}\n",
-                       s(ongoing_d_pt), l(ec));
-                ++q->num_error;
-                return;
-            }
-        }
+    // if source directory doesn't have owner_write then make sure
+    // destination does.
+    if (mkdir(ongoing_d_s.c_str(), (src_stat.st_mode & 07777) | S_IWUSR) == 0) {
         ++q->num_dir_d_success;
-        pr_err(5, "{}: create_directory() ok{}\n", s(ongoing_d_pt), l(ec));
+        pr_err(5, "{}: mkdir() ok{}\n", ongoing_d_s, l());
+    } else if (errno == EEXIST) {
+        ++q->num_dir_d_exists;
+        pr_err(2, "{}: mkdir() failed, already exists{}\n", ongoing_d_s,
+               l());
     } else {
-        if (ec) {
-            ++q->num_dir_d_fail;
-            pr_err(1, "{}: create_directory() failed{}\n", s(ongoing_d_pt),
-                   l(ec));
-        } else {
-            ++q->num_dir_d_exists;
-            pr_err(2, "{}: create_directory() failed{}\n", s(ongoing_d_pt),
+        ec.assign(errno, std::system_category());
+        ++q->num_dir_d_fail;
+        pr_err(1, "{}: mkdir() failed{}\n", ongoing_d_s, l(ec));
+    }
+}
+
+// Decides whether a directory entry is skipped using only its pathname
+// (pt_s) and filename (fn), so before any syscall is made on it. Skipped
+// are entries matching --exclude= or --excl-fn= and, unless --hidden is
+// given, hidden entries. Entries that are also in the --dereference= list
+// are left to the caller since whether they are dereferenced depends on
+// them being symlinks. Returns true when the entry is skipped; the caller
+// should then call disable_recursion_pending() on its iterator.
+template <typename P>
+static bool
+name_prefilter(const sstring & pt_s, std::string_view fn,
+               bool & possible_exclude, bool possible_excl_fn,
+               bool possible_deref, const struct opts_t * op) noexcept
+{
+    struct mut_opts_t * omutp { op->mutp };
+    struct stats_t * q { &omutp->stats };
+
+    if (P::may_filter && (possible_exclude || possible_excl_fn) &&
+        (! (possible_deref &&
+            std::ranges::binary_search(omutp->deref_v, pt_s)))) {
+        bool exclude_entry { false };
+
+        if (possible_exclude) {
+            std::tie(exclude_entry, possible_exclude) =
+                find_in_sorted_vec(omutp->glob_exclude_v, pt_s, true);
+            if (exclude_entry) {
+                ++q->num_excluded;
+                pr_err(3, "{}: matched for exclusion{}\n", pt_s, l());
+                return true;
+            }
+        }
+        if (possible_excl_fn &&
+            std::ranges::binary_search(op->excl_fn_v, fn)) {
+            ++q->num_excl_fn;
+            pr_err(3, "{}: matched {} for excl_fn{}\n", __func__, pt_s,
                    l());
+            return true;
         }
     }
+    if ((! (P::may_hidden && op->clone_hidden)) && (! fn.empty()) &&
+        (fn[0] == '.')) {
+        ++q->num_hidden_skipped;
+        return true;
+    }
+    return false;
 }
 
-// Called from do_clone() and if --deref= given may call itself recursively.
-// There are two levels of error reporting, when ecc is set it will cause
-// the immediate return of that value. If this function has been called
-// recursively, the recursive stack will be quickly unwound. The other
-// variety of errors are placed in 'ec' and are reported in the statistics
-// and may cause processing of the currently node to be stopped and
-// processing will continue to the next node.
+// Called from do_clone() and if --deref= given may call itself recursively
+// (via clone_work()). There are two levels of error reporting, when ecc is
+// set it will cause the immediate return of that value. If this function
+// has been called recursively, the recursive stack will be quickly unwound.
+// The other variety of errors are placed in 'ec' and are reported in the
+// statistics and may cause processing of the currently node to be stopped
+// and processing will continue to the next node.
+// P is one of the scan_pol_t<> policies, see select_scan_pol().
+template <typename P>
 static std::error_code
-clone_work(const fs::path & src_pt, const fs::path & dst_pt,
-           const struct opts_t * op) noexcept
+clone_work_pol(const fs::path & src_pt, const fs::path & dst_pt,
+               const struct opts_t * op) noexcept
 {
     struct mut_opts_t * omutp { op->mutp };
-    bool possible_exclude { ! omutp->glob_exclude_v.empty() };
-    bool possible_excl_fn { ! op->excl_fn_v.empty() };
-    bool possible_deref { ! omutp->deref_v.empty() };
+    bool possible_exclude
+                { P::may_filter && (! omutp->glob_exclude_v.empty()) };
+    bool possible_excl_fn { P::may_filter && (! op->excl_fn_v.empty()) };
+    bool possible_deref { P::may_filter && (! omutp->deref_v.empty()) };
     struct stats_t * q { &omutp->stats };
     struct stat src_stat;
     std::error_code ecc { };
@@ -1869,12 +3370,14 @@ clone_work(const fs::path & src_pt, const fs::path & dst_pt,
         omutp->clone_work_subseq = true;
     else {      // not first call but all after
         if (op->do_extra) {
-            bool src_pt_contained { path_contains_canon(op->source_pt,
-                                                        src_pt) };
+            bool src_pt_contained
+                    { path_contains_canon(op->source_pt.native(),
+                                          src_pt.native()) };
             bool dst_pt_contained { true };
-            if (! op->no_destin)
-                dst_pt_contained = path_contains_canon(op->destination_pt,
-                                                       dst_pt);
+            if (! (P::may_no_destin && op->no_destin))
+                dst_pt_contained =
+                        path_contains_canon(op->destination_pt.native(),
+                                            dst_pt.native());
             bool bad { false };
 
             if (src_pt_contained && dst_pt_contained) {
@@ -1888,7 +3391,7 @@ clone_work(const fs::path & src_pt, const fs::path & dst_pt,
                        s(dst_pt));
                 bad = true;
             }
-            if (op->no_destin)
+            if (P::may_no_destin && op->no_destin)
                 pr_err(0, "{}: src_pt: {}\n", __func__, s(src_pt));
             else
                 pr_err(0, "{}: src_pt: {}, dst_pt: {}\n", __func__,
@@ -1911,14 +3414,20 @@ clone_work(const fs::path & src_pt, const fs::path & dst_pt,
                 ++q->num_error;
                 return ecc;
             }
-            if (! op->no_destin)
-                ecc =  xfr_other_ft(s_ftype, src_pt, src_stat, dst_pt, op);
+            if (! (P::may_no_destin && op->no_destin))
+                ecc =  xfr_other_ft(s_ftype, s(src_pt), src_stat, s(dst_pt),
+                                    op);
             return ecc;
         }       // drops through if is directory [[expected]]
     }
 
     // All fs calls use std::error_code so nothing should throw ... g++
     const fs::recursive_directory_iterator end_itr { };
+    // Source and destination paths of the current node. Both are cut back
+    // to the parent's depth then the node's filename is pushed, so no
+    // fs::path temporaries are built per node.
+    path_bld_t s_bld { s(src_pt) };
+    path_bld_t d_bld { s(dst_pt) };
 
     for (fs::recursive_directory_iterator itr(src_pt, dir_opt, ecc);
          (! ecc) && itr != end_itr;
@@ -1927,14 +3436,25 @@ clone_work(const fs::path & src_pt, const fs::path & dst_pt,
         // since src_pt is in canonical form, assume entry.path()
         // will either be in canonical form, or absolute form if symlink
         std::error_code ec { };
-        const fs::path pt { itr->path() };
-        const auto & pt_s { s(pt) };
+        const fs::path & pt { itr->path() };
+        const std::string_view fn { filename_sv(pt.native()) };
         const auto depth { itr.depth() };
         bool exclude_entry { false };
         bool deref_entry { false };
-        prev_rdi_pt = pt;
+
+        s_bld.trunc_depth(depth);
+        s_bld.push(fn);
+        const sstring & pt_s { s_bld.str() };
+        prev_rdi_s.assign(pt_s);
 
         ++q->num_node;
+        // --no-dst collects stats on hidden and excluded nodes
+        if ((! (P::may_no_destin && op->no_destin)) &&
+            name_prefilter<P>(pt_s, fn, possible_exclude, possible_excl_fn,
+                              possible_deref, op)) {
+            itr.disable_recursion_pending();
+            continue;
+        }
         pr_err(6, "{}: about to scan this source entry{}\n", s(pt), l());
         const auto s_sym_ftype = itr->symlink_status(ec).type();
         if (ec) {       // serious error
@@ -1958,7 +3478,7 @@ clone_work(const fs::path & src_pt, const fs::path & dst_pt,
 
         if (depth > q->max_depth)
             q->max_depth = depth;
-        if (op->max_depth_active &&
+        if (P::may_max_depth && op->max_depth_active &&
             (s_sym_ftype == fs::file_type::directory) &&
             (depth >= op->max_depth)) {
             pr_err(2, "Source at max_depth and this is a directory: {}, "
@@ -1966,9 +3486,9 @@ clone_work(const fs::path & src_pt, const fs::path & dst_pt,
             itr.disable_recursion_pending();
         }
 
-        const bool hidden_entry = ((! pt.empty()) &&
-                                  (s(pt.filename())[0] == '.'));
-        if (possible_deref && (s_sym_ftype == fs::file_type::symlink)) {
+        const bool hidden_entry = ((! fn.empty()) && (fn[0] == '.'));
+        if (P::may_filter && possible_deref &&
+            (s_sym_ftype == fs::file_type::symlink)) {
             std::tie(deref_entry, possible_deref) =
                         find_in_sorted_vec(omutp->deref_v, pt_s, true);
             if (deref_entry) {
@@ -1976,7 +3496,7 @@ clone_work(const fs::path & src_pt, const fs::path & dst_pt,
                 pr_err(3, "{}: matched for dereference{}\n", s(pt), l());
             }
         }
-        if (! deref_entry) {    // deref trumps exclude
+        if (P::may_filter && (! deref_entry)) { // deref trumps exclude
             if (possible_exclude) {
                 std::tie(exclude_entry, possible_exclude) =
                     find_in_sorted_vec(omutp->glob_exclude_v, pt_s, true);
@@ -1986,16 +3506,15 @@ clone_work(const fs::path & src_pt, const fs::path & dst_pt,
                 }
             }
             if (possible_excl_fn) {
-                if (std::ranges::binary_search(op->excl_fn_v,
-                                               s(pt.filename()))) {
+                if (std::ranges::binary_search(op->excl_fn_v, fn)) {
                     ++q->num_excl_fn;
                     exclude_entry = true;
                 }
             }
         }
-        if (op->want_stats > 0)
+        if (P::may_stats && (op->want_stats > 0))
             update_stats(s_sym_ftype, s_ftype, hidden_entry, op);
-        if (op->no_destin) {
+        if (P::may_no_destin && op->no_destin) {
             // for --no-dst only collecting stats after excludes and derefs
             if (deref_entry) {
                 const fs::path target_pt = read_symlink(pt, op, ec);
@@ -2022,7 +3541,8 @@ clone_work(const fs::path & src_pt, const fs::path & dst_pt,
             } else if (exclude_entry)
                 itr.disable_recursion_pending();
             else if ((s_sym_ftype == fs::file_type::directory) &&
-                     op->max_depth_active && (depth >= op->max_depth)) {
+                     P::may_max_depth && op->max_depth_active &&
+                     (depth >= op->max_depth)) {
                 if (cpf_verbose > 2)
                     pr_err(-1, "{}: hits max_depth={}, don't enter {}{}\n",
                            __func__, depth, s(pt), l());
@@ -2030,29 +3550,20 @@ clone_work(const fs::path & src_pt, const fs::path & dst_pt,
             }
             continue;
         }
-        if ((! op->clone_hidden) && hidden_entry) {
-            ++q->num_hidden_skipped;
-            if (s_sym_ftype == fs::file_type::directory)
-                itr.disable_recursion_pending();
-            continue;
-        }
         if ((s_ftype != fs::file_type::none) &&
-            (stat(pt.c_str(), &src_stat) < 0)) {
+            (stat(pt_s.c_str(), &src_stat) < 0)) {
             ec.assign(errno, std::system_category());
-            pr_err(-1, "stat({}) failed{}\n", s(pt), l(ec));
+            pr_err(-1, "stat({}) failed{}\n", pt_s, l(ec));
             ++q->num_error;
             continue;
         }
-        fs::path rel_pt { fs::proximate(pt, src_pt, ec) };
-        if (ec) {
-            pr_err(1, "{}: proximate() failed{}\n", s(pt), l(ec));
-            ++q->num_error;
-            continue;
-        }
-        fs::path ongoing_d_pt { dst_pt / rel_pt };
-        if (cpf_verbose > 4)
-        pr_err(4, "{}: pt: {}, rel_path: {}, ongoing_d_pt: {}\n", __func__,
-               s(pt), s(rel_pt), s(ongoing_d_pt));
+        // d_bld holds the destination parent directory after this
+        d_bld.trunc_depth(depth);
+        const size_t prox_sz { d_bld.str().size() };
+        d_bld.push(fn);
+        const sstring & ongoing_d_s { d_bld.str() };
+        pr_err(4, "{}: pt: {}, ongoing_d_s: {}\n", __func__, pt_s,
+               ongoing_d_s);
 
         switch (s_sym_ftype) {
         using enum fs::file_type;
@@ -2062,28 +3573,18 @@ clone_work(const fs::path & src_pt, const fs::path & dst_pt,
                 itr.disable_recursion_pending();
                 continue;
             }
-            dir_clone_work(pt, itr, src_stat.st_dev,
-                           itr_status.permissions(), ongoing_d_pt, op, ec);
+            dir_clone_work<P>(pt_s, itr, src_stat, ongoing_d_s, op, ec);
             break;
         case symlink:
             {
                 if (exclude_entry)
                     break;
-                const fs::path parent_pt { pt.parent_path() };
-                fs::path prox_pt { dst_pt };
-                if (parent_pt != src_pt) {
-                    prox_pt /= fs::proximate(parent_pt, src_pt, ec);
-                    if (ec) {
-                        pr_err(-1, "symlink: proximate({}) failed{}\n",
-                               s(parent_pt), l(ec));
-                        ++q->num_error;
-                        break;
-                    }
-                }
+                const std::string_view prox_sv { ongoing_d_s.data(),
+                                                 prox_sz };
                 bool serious;
 
                 std::tie(ec, serious) =
-                        symlink_clone_work(pt, prox_pt, ongoing_d_pt,
+                        symlink_clone_work(pt, prox_sv, ongoing_d_s,
                                            deref_entry, op);
                 if (serious)
                     return ec;
@@ -2097,7 +3598,7 @@ clone_work(const fs::path & src_pt, const fs::path & dst_pt,
         case unknown:
             if (exclude_entry)
                 continue;
-            ec = xfr_other_ft(s_sym_ftype, pt, src_stat, ongoing_d_pt, op);
+            ec = xfr_other_ft(s_sym_ftype, pt_s, src_stat, ongoing_d_s, op);
             ec.clear();
             break;
         default:                // here when something no longer exists
@@ -2105,7 +3606,8 @@ clone_work(const fs::path & src_pt, const fs::path & dst_pt,
             using enum fs::file_type;
 
             case directory:
-                if (op->max_depth_active && (depth >= op->max_depth)) {
+                if (P::may_max_depth && op->max_depth_active &&
+                    (depth >= op->max_depth)) {
                     pr_err(2, "Source: {} at max_depth: {}, don't enter\n",
                            s(pt), depth);
                     itr.disable_recursion_pending();
@@ -2129,7 +3631,7 @@ clone_work(const fs::path & src_pt, const fs::path & dst_pt,
     if (ecc) {
         ++q->num_scan_failed;
         pr_err(-1, "recursive_directory_iterator() failed, prior entry: "
-               "{}{}\n", s(prev_rdi_pt), l(ecc));
+               "{}{}\n", prev_rdi_s, l(ecc));
     }
     return ecc;
 }
@@ -2196,7 +3698,8 @@ symlink_cache_src(const fs::path & pt, const short_stat & a_shstat,
             ++q->num_sym_s_dangle;
             return {ec, false};
         }
-        if (! path_contains_canon(op->source_pt, canon_s_targ_pt)) {
+        if (! path_contains_canon(op->source_pt.native(),
+                                  canon_s_targ_pt.native())) {
             ++q->num_follow_sym_outside;
             pr_err(0, "{}: outside, fall back to symlink{}\n",
                    s(canon_s_targ_pt), l());
@@ -2212,7 +3715,8 @@ symlink_cache_src(const fs::path & pt, const short_stat & a_shstat,
             prev_odirp = l_odirp;
             inmem_dir_t a_dir(filename_pt, a_shstat);
             a_dir.par_pt_s = s(par_pt);
-            auto depth = path_depth(s(par_pt), op->source_pt, op, ec);
+            auto depth = path_depth(par_pt.native(), op->source_pt.native(),
+                                    op, ec);
             if (ec)
                 depth = 0;
             a_dir.depth = depth + 1;    // asked depth of parent ...
@@ -2222,13 +3726,23 @@ symlink_cache_src(const fs::path & pt, const short_stat & a_shstat,
                 const auto ctspt { s(canon_s_targ_pt) + "\n" };
                 const char * ccp { ctspt.c_str() };
                 const uint8_t * bp { reinterpret_cast<const uint8_t *>(ccp) };
-                std::vector<uint8_t> v(bp, bp + ctspt.size());
                 short_stat b_shstat { a_shstat };
                 b_shstat.st_mode &= ~stat_perm_mask;
                 b_shstat.st_mode |= def_file_perm;
                 inmem_regular_t a_reg(src_symlink_tgt_path, b_shstat);
 
-                a_reg.contents.swap(v);
+                if (! a_reg.contents.assign(bp, ctspt.size(),
+                                            *op->mutp->arenap)) {
+                    ec.assign(ENOMEM, std::system_category());
+                    pr_err(-1, "{}: unable to hold symlink target path{}\n",
+                           s(pt), l(ec));
+                    ++q->num_error;
+                    return {ec, false};
+                }
+                if (op->dedup || op->sqfs_fn)
+                    a_reg.contents_hash =
+                        cpf_hash::hash64(a_reg.contents.data(),
+                                         a_reg.contents.size());
                 a_reg.always_use_contents = true;
                 l_odirp->add_to_sdir_v(a_reg);
                 ec = cache_src(l_odirp, canon_s_targ_pt, op);
@@ -2247,6 +3761,30 @@ process_as_symlink:
     return {ec, false};
 }
 
+// Returns the node named fn in the directory at dirp, else nullptr. Until
+// sort_cache() has run only sub-directories are found (via sdir_fn_ind_m),
+// after that any node is found by binary search.
+static inmem_t *
+find_sub(const inmem_dir_t * dirp, const sstring & fn,
+         const struct opts_t * op) noexcept
+{
+    auto & sdir_v { dirp->sdirs_sp->sdir_v };
+
+    if (op->mutp->cache_sorted) {
+        const auto it { std::ranges::lower_bound(sdir_v, fn, { },
+                        [](const inmem_t & a) -> const sstring &
+                                { return a.get_basep()->filename; }) };
+
+        if ((it == sdir_v.end()) || (it->get_basep()->filename != fn))
+            return nullptr;
+        return &*it;
+    }
+    const auto & mm { dirp->sdirs_sp->sdir_fn_ind_m };
+    const auto it { mm.find(fn) };
+
+    return (it == mm.end()) ? nullptr : &sdir_v[it->second];
+}
+
 // Tracking a directory recursive descent iterator for the purposes of
 // building an in-memory hierarchial representation is relatively easy
 // until the iterator goes back up (i.e. towards the root) 2 or more
@@ -2261,7 +3799,8 @@ cache_recalc_grandparent(const fs::path & par_pt,
                          const struct opts_t * op, std::error_code & ec)
                          noexcept
 {
-    const std::vector<sstring> vs { split_path(par_pt, osrc_pt, op, ec) };
+    const std::vector<sstring> vs { split_path(par_pt.native(),
+                                                osrc_pt.native(), op, ec) };
     if (ec) {
         pr_err(-1, "{}: split_path({}, {}) failed{}\n", __func__, s(par_pt),
                s(osrc_pt), l(ec));
@@ -2270,15 +3809,13 @@ cache_recalc_grandparent(const fs::path & par_pt,
     // par_pt is most likely associated with the target (directory) of a
     // symlink and a component of its par_pt may match an element of
     // op->excl_fn_v . If so do nothing (return pair of nullptr_s).
-    if (! op->excl_fn_v.empty()) {
-        bool excl_fn_match { };
-        for (const auto & c : vs) {
-            if (std::ranges::binary_search(op->excl_fn_v, c)) {
-                excl_fn_match = true;
-                break;
-            }
-        }
-        if (excl_fn_match) {
+    if ((! op->excl_fn_v.empty()) && (! vs.empty())) {
+        // split_path() succeeded so par_pt is below osrc_pt
+        const sstring & par_s { par_pt.native() };
+
+        if (path_comp_in_sorted(par_s.data() + osrc_pt.native().size(),
+                                par_s.data() + par_s.size(),
+                                op->excl_fn_v)) {
             pr_err(3, "{}: component of parent path: {} matches an EFN, "
                    "skip\n", __func__, s(par_pt));
             return false;
@@ -2289,17 +3826,15 @@ cache_recalc_grandparent(const fs::path & par_pt,
     l_odirp = odirp;
 
     for (const auto & ss : vs) {
-        const auto & mm { l_odirp->sdirs_sp->sdir_fn_ind_m };
-        const auto it { mm.find(ss) };
+        inmem_t * childp { find_sub(l_odirp, ss, op) };
 
-        if (it == mm.end()) {
+        if (childp == nullptr) {
             ec.assign(ENOENT, std::system_category());
             pr_err(1, "{} {}: unable to find that sub-path{}\n", s(par_pt),
                    ss, l());
             l_odirp = prev_odirp;
             return false;
         }
-        inmem_t * childp { &l_odirp->sdirs_sp->sdir_v[it->second] };
         l_odirp = std::get_if<inmem_dir_t>(childp);
         if (l_odirp == nullptr) {
             ec.assign(ENOTDIR, std::system_category());
@@ -2326,7 +3861,8 @@ prune_mark_up_chain(const fs::path & par_pt, const struct opts_t * op,
     std::pair<inmem_dir_t *, inmem_regular_t *> res { };
     const fs::path & osrc_pt { op->source_pt };
 
-    const std::vector<sstring> vs { split_path(par_pt, osrc_pt, op, ec) };
+    const std::vector<sstring> vs { split_path(par_pt.native(),
+                                                osrc_pt.native(), op, ec) };
     if (ec) {
         pr_err(-1, "{}: split_path({}) failed{}\n", __func__, s(par_pt),
                l(ec));
@@ -2339,31 +3875,28 @@ prune_mark_up_chain(const fs::path & par_pt, const struct opts_t * op,
     }
     // step down hierarchy from source root
     for (const auto & ss : vs) {
-        const auto & mm { l_odirp->sdirs_sp->sdir_fn_ind_m };
-        const auto it { mm.find(ss) };
+        inmem_t * childp { find_sub(l_odirp, ss, op) };
 
-        if (it == mm.end()) {   // not there, or not a directory
+        if ((childp == nullptr) && (! op->mutp->cache_sorted)) {
+            // sdir_fn_ind_m only holds directories
             for (auto & sub : l_odirp->sdirs_sp->sdir_v) {
-                if (sub.get_filename() == ss) {
-                    res.second = std::get_if<inmem_regular_t>(&sub);
-                    if (res.second)
-                        return res;
+                if (sub.get_basep()->filename == ss) {
+                    childp = &sub;
+                    break;
                 }
             }
+        }
+        l_odirp = childp ? std::get_if<inmem_dir_t>(childp) : nullptr;
+        if (l_odirp == nullptr) {       // not there, or not a directory
+            res.second = childp ? std::get_if<inmem_regular_t>(childp) :
+                                  nullptr;
+            if (res.second)
+                return res;
             ec.assign(ENOENT, std::system_category());
             pr_err(1, "{}: path: {}, component: {} not found{}\n", __func__,
                    s(par_pt), ss, l());
             return res;         // pair of nullptr_s
         }
-        inmem_t * childp { &l_odirp->sdirs_sp->sdir_v[it->second] };
-
-        l_odirp = std::get_if<inmem_dir_t>(childp);
-        if (l_odirp == nullptr) {
-            ec.assign(ENOTDIR, std::system_category());
-            pr_err(0, "node: {} was not sub-directory in: {}{}\n", ss,
-                   s(par_pt), l());
-            return res;
-        }
         inmem_base_t * ibp = childp->get_basep();
         if (ibp->prune_mask == 0) {
             ibp->prune_mask |= prune_up_chain;
@@ -2380,19 +3913,26 @@ prune_mark_up_chain(const fs::path & par_pt, const struct opts_t * op,
 // of nodes that would otherwise be placed in the in-memory tree.
 // Note: cache_src() may be called recursively via the symlink_cache_src()
 // function when dereferencing the symlink's target.
+// P is one of the scan_pol_t<> policies, see select_scan_pol().
+template <typename P>
 static std::error_code
-cache_src(inmem_dir_t * start_dirp, const fs::path & osrc_pt,
-          const struct opts_t * op) noexcept
+cache_src_pol(inmem_dir_t * start_dirp, const fs::path & osrc_pt,
+              const struct opts_t * op) noexcept
 {
     struct mut_opts_t * omutp { op->mutp };
+    // taken here so cache_src() calls made by --deref do not see them
+    const int depth_base { std::exchange(omutp->scan_depth_base, 0) };
+    auto * unit_vp { std::exchange(omutp->par_unit_vp, nullptr) };
     bool cache_src_first = ! omutp->cache_src_subseq;
-    bool possible_exclude
-                { cache_src_first && (! omutp->glob_exclude_v.empty()) };
-    bool possible_excl_fn { ! op->excl_fn_v.empty() };
-    bool possible_deref { cache_src_first && (! omutp->deref_v.empty()) };
-    bool possible_prune { cache_src_first && (! omutp->prune_v.empty()) };
+    bool possible_exclude { P::may_filter && cache_src_first &&
+                            (! omutp->glob_exclude_v.empty()) };
+    bool possible_excl_fn { P::may_filter && (! op->excl_fn_v.empty()) };
+    bool possible_deref { P::may_filter && cache_src_first &&
+                          (! omutp->deref_v.empty()) };
+    bool possible_prune { P::may_filter && cache_src_first &&
+                          (! omutp->prune_v.empty()) };
     int depth;
-    int prev_depth { -1 };    // assume descending into directory
+    int prev_depth { depth_base - 1 };  // assume descending into directory
     int prev_dir_ind { -1 };
     inmem_dir_t * l_odirp { start_dirp };
     inmem_dir_t * prev_odirp { };
@@ -2407,8 +3947,9 @@ cache_src(inmem_dir_t * start_dirp, const fs::path & osrc_pt,
     }
     if (omutp->cache_src_subseq) {
         if (op->do_extra) {
-            bool src_pt_contained { path_contains_canon(op->source_pt,
-                                                        osrc_pt) };
+            bool src_pt_contained
+                    { path_contains_canon(op->source_pt.native(),
+                                          osrc_pt.native()) };
 
             if (! src_pt_contained) {
                 pr_err(-1, "{}: src: {} NOT contained{}{}\n", __func__,
@@ -2444,23 +3985,16 @@ cache_src(inmem_dir_t * start_dirp, const fs::path & osrc_pt,
         // will either be in canonical form, or absolute form if symlink
         const auto & pt = itr->path();
         const auto & pt_s { s(pt) };
-        prev_rdi_pt = pt;
+        prev_rdi_s.assign(pt_s);
         const sstring filename { pt.filename() };
         const auto par_pt = pt.parent_path();
-        depth = itr.depth();
+        depth = itr.depth() + depth_base;
         bool exclude_entry { false };
         bool deref_entry { false };
         bool got_prune_exact { false };
 
-        const auto s_sym_ftype { itr->symlink_status(ec).type() };
-        if (ec) {       // serious error
-            ++q->num_error;
-            pr_err(2, "symlink_status({}) failed, continue{}\n", s(pt),
-                   l(ec));
-            // thought of using entry.refresh(ec) but no speed improvement
-            continue;
-        }
-        const auto l_isdir = (s_sym_ftype == fs::file_type::directory);
+        // the parent tracking below needs no syscalls so is done for
+        // every entry, including those name_prefilter() skips
         if (depth > prev_depth) {
             if (depth == (prev_depth + 1))
                 prev_odirp = l_odirp;
@@ -2493,10 +4027,25 @@ cache_src(inmem_dir_t * start_dirp, const fs::path & osrc_pt,
         ++q->num_node;
         // if (q->num_node >= 240000)
             // break;
+        if (name_prefilter<P>(pt_s, filename, possible_exclude,
+                              possible_excl_fn, possible_deref, op)) {
+            itr.disable_recursion_pending();
+            continue;
+        }
         pr_err(6, "about to scan this source entry: {}{}\n", s(pt), l());
+        const auto s_sym_ftype { itr->symlink_status(ec).type() };
+        if (ec) {       // serious error
+            ++q->num_error;
+            pr_err(2, "symlink_status({}) failed, continue{}\n", s(pt),
+                   l(ec));
+            // thought of using entry.refresh(ec) but no speed improvement
+            continue;
+        }
+        const auto l_isdir = (s_sym_ftype == fs::file_type::directory);
         if (depth > q->max_depth)
             q->max_depth = depth;
-        if (op->max_depth_active && l_isdir && (depth >= op->max_depth)) {
+        if (P::may_max_depth && op->max_depth_active && l_isdir &&
+            (depth >= op->max_depth)) {
             pr_err(2, "Source: {} at max_depth: {}, don't enter\n",
                    s(pt), depth);
             itr.disable_recursion_pending();
@@ -2510,6 +4059,12 @@ cache_src(inmem_dir_t * start_dirp, const fs::path & osrc_pt,
             continue;
         }
         bool is_symlink { (a_stat.st_mode & S_IFMT) == S_IFLNK };
+        // not for --deref scans, their paths are not those in DPATH
+        if (op->preserve && cache_src_first)
+            omutp->meta_v.push_back({pt_s.substr(omutp->starting_src_sz),
+                                     depth, a_stat.st_mode, a_stat.st_uid,
+                                     a_stat.st_gid, a_stat.st_atim,
+                                     a_stat.st_mtim});
         a_shstat.st_dev = a_stat.st_dev;
         a_shstat.st_mode = a_stat.st_mode;
         auto s_ftype { itr->status(ec).type() };
@@ -2526,7 +4081,8 @@ cache_src(inmem_dir_t * start_dirp, const fs::path & osrc_pt,
         }
 
         const bool hidden_entry { ((! pt.empty()) && (filename[0] == '.')) };
-        if (possible_deref && (s_sym_ftype == fs::file_type::symlink)) {
+        if (P::may_filter && possible_deref &&
+            (s_sym_ftype == fs::file_type::symlink)) {
             std::tie(deref_entry, possible_deref) =
                         find_in_sorted_vec(omutp->deref_v, pt_s, true);
             if (deref_entry) {
@@ -2534,7 +4090,7 @@ cache_src(inmem_dir_t * start_dirp, const fs::path & osrc_pt,
                 pr_err(3, "{}: matched for dereference{}\n", s(pt), l());
             }
         }
-        if (! deref_entry) {    // deref trumps exclude
+        if (P::may_filter && (! deref_entry)) { // deref trumps exclude
             if (possible_exclude) {
                 std::tie(exclude_entry, possible_exclude) =
                     find_in_sorted_vec(omutp->glob_exclude_v, pt_s, true);
@@ -2552,9 +4108,10 @@ cache_src(inmem_dir_t * start_dirp, const fs::path & osrc_pt,
                 }
             }
         }
-        if (possible_prune && ((s_sym_ftype == fs::file_type::directory) ||
-                               (s_sym_ftype == fs::file_type::symlink) ||
-                               (s_sym_ftype == fs::file_type::regular))) {
+        if (P::may_filter && possible_prune &&
+            ((s_sym_ftype == fs::file_type::directory) ||
+             (s_sym_ftype == fs::file_type::symlink) ||
+             (s_sym_ftype == fs::file_type::regular))) {
             bool prune_entry { };
 
             std::tie(prune_entry, possible_prune) =
@@ -2562,20 +4119,21 @@ cache_src(inmem_dir_t * start_dirp, const fs::path & osrc_pt,
             if (prune_entry)
                 got_prune_exact = true;
         }
-        if (op->want_stats > 0)
+        if (P::may_stats && (op->want_stats > 0))
             update_stats(s_sym_ftype, s_ftype, hidden_entry, op);
         if (l_isdir) {
             if (exclude_entry) {
                 itr.disable_recursion_pending();
                 continue;
             }
-            if (op->max_depth_active && (depth >= op->max_depth)) {
+            if (P::may_max_depth && op->max_depth_active &&
+                (depth >= op->max_depth)) {
                 pr_err(2, "Source at max_depth={} and this is a directory: "
                        "{}, don't enter{}\n", depth, s(pt), l());
                 itr.disable_recursion_pending();
                 continue;
             }
-            if (! op->no_xdev) { // double negative ...
+            if (! (P::may_no_xdev && op->no_xdev)) { // double negative ...
                 if (a_stat.st_dev != omutp->starting_fs_inst) {
                     // do not visit this sub-branch: different fs instance
                     pr_err(1, "Source trying to leave this fs instance at: "
@@ -2588,13 +4146,6 @@ cache_src(inmem_dir_t * start_dirp, const fs::path & osrc_pt,
         } else if (exclude_entry)
             continue;
 
-        if ((! op->clone_hidden) && hidden_entry) {
-            ++q->num_hidden_skipped;
-            if (s_sym_ftype == fs::file_type::directory)
-                itr.disable_recursion_pending();
-            continue;
-        }
-
         switch (s_sym_ftype) {
         using enum fs::file_type;
 
@@ -2619,6 +4170,19 @@ cache_src(inmem_dir_t * start_dirp, const fs::path & osrc_pt,
                     ++q->num_prune_exact;
                 }
                 prev_dir_ind = l_odirp->add_to_sdir_v(a_dir);
+                if (unit_vp && itr.recursion_pending()) {
+                    // tracefs per_cpu/cpuN subtrees are always split off
+                    const int cpu { trace_cpu_dir(pt_s, a_stat.st_dev,
+                                                  op) };
+
+                    if ((cpu >= 0) || ((depth == par_fan_depth) &&
+                                       (op->jobs > 1))) {
+                        itr.disable_recursion_pending();
+                        unit_vp->push_back({l_odirp->sdirs_sp,
+                                            static_cast<size_t>(prev_dir_ind),
+                                            pt_s, depth, cpu});
+                    }
+                }
             }
             break;
         case block:
@@ -2657,52 +4221,333 @@ cache_src(inmem_dir_t * start_dirp, const fs::path & osrc_pt,
     if (ecc) {
         ++q->num_scan_failed;
         pr_err(-1, "recursive_directory_iterator() failed, prior entry: "
-               "{}{}\n", s(prev_rdi_pt), l(ecc));
+               "{}{}\n", prev_rdi_s, l(ecc));
     }
     return ecc;
 }
 
+// Calls the clone_work_pol<> instantiation chosen by select_scan_pol().
+static std::error_code
+clone_work(const fs::path & src_pt, const fs::path & dst_pt,
+           const struct opts_t * op) noexcept
+{
+    return op->mutp->clone_work_fp(src_pt, dst_pt, op);
+}
+
+// Calls the cache_src_pol<> instantiation chosen by select_scan_pol().
+static std::error_code
+cache_src(inmem_dir_t * start_dirp, const fs::path & osrc_pt,
+          const struct opts_t * op) noexcept
+{
+    return op->mutp->cache_src_fp(start_dirp, osrc_pt, op);
+}
+
+// Calls work_f(k, t) for each k in [0, num_work) on up to num_thr threads,
+// t being the index of the thread doing the call. The calling thread is
+// thread 0. Work items are claimed through an atomic index so a thread that
+// drew a small item comes straight back for another. If a thread cannot be
+// started, the threads already running (at least the caller) do its share.
+template <typename F>
+static void
+run_workers(unsigned int num_thr, size_t num_work, F && work_f) noexcept
+{
+    std::atomic<size_t> next_k { 0 };
+    std::vector<std::thread> thr_v;
+    auto thr_f = [&](unsigned int t) {
+        for (size_t k; (k = next_k.fetch_add(1, std::memory_order_relaxed)) <
+                       num_work; )
+            work_f(k, t);
+    };
+
+    if (num_thr > num_work)
+        num_thr = num_work;
+    for (unsigned int t { 1 }; t < num_thr; ++t) {
+        try {
+            thr_v.emplace_back(thr_f, t);
+        }
+        catch (...) {
+            pr_err(0, "{}: only able to start {} threads{}\n", __func__, t,
+                   l());
+            break;
+        }
+    }
+    thr_f(0);
+    for (auto & thr : thr_v)
+        thr.join();
+}
+
+// Adds the counters in 'from' to those in 'to'. All members of stats_t
+// bar the last (max_depth) are unsigned int counters.
+static void
+stats_merge(struct stats_t & to, const struct stats_t & from) noexcept
+{
+    static_assert(offsetof(stats_t, max_depth) ==
+                  sizeof(stats_t) - sizeof(int));
+    const size_t num_ctr { offsetof(stats_t, max_depth) /
+                           sizeof(unsigned int) };
+    auto * tp { reinterpret_cast<unsigned int *>(&to) };
+    auto * fp { reinterpret_cast<const unsigned int *>(&from) };
+
+    for (size_t k { }; k < num_ctr; ++k)
+        tp[k] += fp[k];
+    to.max_depth = std::max(to.max_depth, from.max_depth);
+}
+
+// Restricts the calling thread to run on cpu, placing its previous CPU
+// affinity in prev_set. Returns true if prev_set should later be restored.
+static bool
+pin_to_cpu(int cpu, cpu_set_t & prev_set) noexcept
+{
+    cpu_set_t set;
+
+    if ((cpu < 0) || (cpu >= CPU_SETSIZE)) {
+        pr_err(4, "{}: cpu{} beyond CPU_SETSIZE, not pinned{}\n", __func__,
+               cpu, l());
+        return false;
+    }
+    if (sched_getaffinity(0, sizeof(prev_set), &prev_set) < 0)
+        return false;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+        pr_err(4, "{}: unable to pin to cpu{}{}\n", __func__, cpu, l());
+        return false;
+    }
+    return true;
+}
+
+// Pass 1. The calling thread scans the source tree, adding but not
+// entering each directory found at par_fan_depth (only when --jobs=NJ
+// with NJ > 1) and each tracefs per_cpu/cpuN directory. Those
+// directories' subtrees are then scanned by worker threads, each into its
+// own (already published) node, so no two threads ever add to the same
+// sub-directory vector. Each worker has its own copy of the options (hence
+// its own read buffer and statistics) which are merged back when all
+// workers are done. A per_cpu/cpuN subtree is read by a thread pinned to
+// CPU N so its ring buffer is read from CPU local memory, while the
+// buffers of the other CPUs are read at the same time.
+static std::error_code
+cache_src_par(const struct opts_t * op) noexcept
+{
+    struct mut_opts_t * omutp { op->mutp };
+    std::vector<par_unit_t> unit_v;
+    std::error_code ec { };
+
+    omutp->par_unit_vp = &unit_v;
+    ec = cache_src(omutp->cache_rt_dirp, op->source_pt, op);
+    if (ec || unit_v.empty())
+        return ec;
+
+    unsigned int max_thr { op->jobs };
+
+    // without --jobs=NJ (also given for each clone of do_multi_src()),
+    // per_cpu units get a thread per CPU, else they share the NJ threads
+    for (const auto & u : unit_v) {
+        if ((u.cpu >= 0) && (! op->jobs_given)) {
+            max_thr = std::max(max_thr, std::thread::hardware_concurrency());
+            break;
+        }
+    }
+    const unsigned int num_thr
+                { static_cast<unsigned int>(std::min(static_cast<size_t>(
+                                            max_thr), unit_v.size())) };
+    std::vector<struct mut_opts_t> wmut_v(num_thr, *omutp);
+    std::vector<struct opts_t> wopt_v(num_thr, *op);
+    std::vector<std::error_code> ec_v(unit_v.size());
+
+    for (unsigned int t { }; t < num_thr; ++t) {
+        wmut_v[t].stats = { };
+        wmut_v[t].meta_v.clear();
+        wopt_v[t].mutp = &wmut_v[t];
+        if (op->reglen > def_reglen) {
+            wopt_v[t].reg_buff_sp =
+                std::make_shared<uint8_t []>((size_t)op->reglen, 0);
+            if (! wopt_v[t].reg_buff_sp) {
+                ec.assign(ENOMEM, std::system_category());
+                return ec;
+            }
+        }
+    }
+    pr_err(3, "{}: {} subtrees to {} threads{}\n", __func__, unit_v.size(),
+           num_thr, l());
+    run_workers(num_thr, unit_v.size(), [&](size_t k, unsigned int t) {
+        const par_unit_t & u { unit_v[k] };
+        auto * dirp { std::get_if<inmem_dir_t>(
+                                &u.par_sdirs_sp->sdir_v[u.ind]) };
+
+        cpu_set_t prev_set;
+        const bool pinned { (u.cpu >= 0) && pin_to_cpu(u.cpu, prev_set) };
+
+        // each subtree is scanned as if it was the source root
+        wmut_v[t].cache_src_subseq = false;
+        wmut_v[t].scan_depth_base = u.depth + 1;
+        ec_v[k] = cache_src(dirp, u.pt_s, &wopt_v[t]);
+        if (pinned)
+            sched_setaffinity(0, sizeof(prev_set), &prev_set);
+    });
+    for (auto & wmut : wmut_v) {
+        stats_merge(omutp->stats, wmut.stats);
+        std::ranges::move(wmut.meta_v, std::back_inserter(omutp->meta_v));
+    }
+    for (const auto & wec : ec_v) {
+        if (wec)
+            return wec;
+    }
+    return ec;
+}
+
+// Picks, once before the source scan starts, which instantiations of the
+// scan loops to use. Any option that is not covered by one of the common
+// combinations selects the general policy which tests all options for
+// each node.
+static void
+select_scan_pol(const struct opts_t * op) noexcept
+{
+    const char * pol_nm;
+    struct mut_opts_t * omutp { op->mutp };
+    bool general { (! omutp->glob_exclude_v.empty()) ||
+                   (! op->excl_fn_v.empty()) || (! omutp->deref_v.empty()) ||
+                   (! omutp->prune_v.empty()) || op->clone_hidden ||
+                   op->max_depth_active || op->no_xdev };
+
+    if (general) {
+        omutp->clone_work_fp = clone_work_pol<scan_pol_gen>;
+        omutp->cache_src_fp = cache_src_pol<scan_pol_gen>;
+        pol_nm = "general";
+    } else if (op->no_destin) {
+        if (op->want_stats > 0) {
+            omutp->clone_work_fp = clone_work_pol<scan_pol_nodst_stats>;
+            omutp->cache_src_fp = cache_src_pol<scan_pol_nodst_stats>;
+            pol_nm = "no destination, statistics";
+        } else {
+            omutp->clone_work_fp = clone_work_pol<scan_pol_nodst>;
+            omutp->cache_src_fp = cache_src_pol<scan_pol_nodst>;
+            pol_nm = "no destination";
+        }
+    } else if (op->want_stats > 0) {
+        omutp->clone_work_fp = clone_work_pol<scan_pol_def_stats>;
+        omutp->cache_src_fp = cache_src_pol<scan_pol_def_stats>;
+        pol_nm = "default, statistics";
+    } else {
+        omutp->clone_work_fp = clone_work_pol<scan_pol_def>;
+        omutp->cache_src_fp = cache_src_pol<scan_pol_def>;
+        pol_nm = "default";
+    }
+    pr_err(1, "source scan policy: {}\n", pol_nm);
+}
+
+// The cache tree can be deep, so it is walked with an explicit stack here
+// and in the other tree traversals below, rather than by recursion.
 static size_t
 count_cache(const inmem_dir_t * odirp, bool recurse,
-            const struct opts_t * op) noexcept
+            [[maybe_unused]] const struct opts_t * op) noexcept
 {
-    size_t sz, k;
+    size_t k { };
 
     if (odirp == nullptr)
         return 0;
-    sz = odirp->sdirs_sp->sdir_v.size();
-    if (! recurse) {
-        return sz;
-    }
-    for (k = 0; const auto & sub : odirp->sdirs_sp->sdir_v) {
-        const auto * cdirp { std::get_if<inmem_dir_t>(&sub) };
+    if (! recurse)
+        return odirp->sdirs_sp->sdir_v.size();
+    std::vector<const inmem_dir_t *> stk { odirp };
+
+    while (! stk.empty()) {
+        const inmem_dir_t * dirp { stk.back() };
 
-        ++k;
-        if (cdirp)
-            k += count_cache(cdirp, recurse, op);
+        stk.pop_back();
+        for (const auto & sub : dirp->sdirs_sp->sdir_v) {
+            ++k;
+            if (const auto * cdirp { std::get_if<inmem_dir_t>(&sub) })
+                stk.push_back(cdirp);
+        }
     }
     return k;
 }
 
+// With --sort, orders each directory's sdir_v by filename, bytewise as
+// strcmp(3) does, so the unroll (and --columnar and the -vvvvvv dump) no
+// longer follow the getdents(2) order of the source which can differ
+// between boots. Rather than moving inmem_t objects about, an index keyed
+// on the first 8 bytes of each filename (big endian so integer order is
+// byte order) is sorted; full filenames are only compared when those
+// keys tie. The vector is then rebuilt once in that order. Once sorted,
+// find_sub() uses binary search, so sdir_fn_ind_m is released. Run after
+// pass 1 as its parallel units and --deref scans use sdir_v indexes.
+static void
+sort_cache(inmem_dir_t * odirp, const struct opts_t * op) noexcept
+{
+    struct key_ind_t {
+        uint64_t key;
+        uint32_t ind;
+    };
+    std::vector<key_ind_t> ki_v;
+    std::vector<inmem_dir_t *> stk { odirp };
+
+    while (! stk.empty()) {
+        inmem_subdirs_t & sds { *stk.back()->sdirs_sp };
+        auto & sdir_v { sds.sdir_v };
+        const size_t sz { sdir_v.size() };
+
+        stk.pop_back();
+        ki_v.clear();
+        for (uint32_t k { }; k < sz; ++k) {
+            const sstring & fn { sdir_v[k].get_basep()->filename };
+            const size_t fn_sz { fn.size() };
+            uint64_t key { };
+
+            for (size_t j { }; j < 8; ++j)
+                key = (key << 8) | ((j < fn_sz) ?
+                                    static_cast<uint8_t>(fn[j]) : 0);
+            ki_v.push_back({key, k});
+        }
+        auto ki_less = [&sdir_v](const key_ind_t & a, const key_ind_t & b)
+        {
+            if (a.key != b.key)
+                return a.key < b.key;
+            return sdir_v[a.ind].get_basep()->filename <
+                   sdir_v[b.ind].get_basep()->filename;
+        };
+        if (! std::ranges::is_sorted(ki_v, ki_less)) {
+            std::vector<inmem_t> n_v;
+
+            std::ranges::sort(ki_v, ki_less);
+            n_v.reserve(sz);
+            for (const auto & ki : ki_v)
+                n_v.push_back(std::move(sdir_v[ki.ind]));
+            sdir_v.swap(n_v);
+        }
+        std::map<sstring, size_t>().swap(sds.sdir_fn_ind_m);
+        // sdir_v is final so pointers into it now stay valid
+        for (auto & sub : sdir_v) {
+            if (auto * cdirp { std::get_if<inmem_dir_t>(&sub) })
+                stk.push_back(cdirp);
+        }
+    }
+    op->mutp->cache_sorted = true;
+}
+
 // For simplicity and speed, exclusions and dereferences are ignored.
 static void
 depth_count_cache(const inmem_dir_t * odirp, std::vector<size_t> & ra,
                   int depth = -1) noexcept
 {
-    size_t sz, v_sz;
-    size_t d { static_cast<size_t>(depth + 1) };  // depth starts at -1
-
     if (odirp == nullptr)
         return;
-    sz = odirp->sdirs_sp->sdir_v.size();
-    v_sz = ra.size();
-    if (d >= v_sz)
-        ra.push_back(sz);
-    else
-        ra[d] += sz;
-    for (const auto & sub : odirp->sdirs_sp->sdir_v) {
-        if (const auto * cdirp { std::get_if<inmem_dir_t>(&sub) }) {
-            depth_count_cache(cdirp, ra, cdirp->depth);
+    // a directory is popped after its parent so ra never has a gap
+    std::vector<std::pair<const inmem_dir_t *, int>> stk { {odirp, depth} };
+
+    while (! stk.empty()) {
+        const auto [dirp, dir_depth] { stk.back() };
+        const size_t sz { dirp->sdirs_sp->sdir_v.size() };
+        const size_t d { static_cast<size_t>(dir_depth + 1) };  // from -1
+
+        stk.pop_back();
+        if (d >= ra.size())
+            ra.push_back(sz);
+        else
+            ra[d] += sz;
+        for (const auto & sub : dirp->sdirs_sp->sdir_v) {
+            if (const auto * cdirp { std::get_if<inmem_dir_t>(&sub) })
+                stk.emplace_back(cdirp, cdirp->depth);
         }
     }
 }
@@ -2766,7 +4611,16 @@ show_cache_not_dir(const inmem_t & a_nod,
     pr_err(5, "    &inmem_t: {:p}\n", (void *)&a_nod);
 }
 
-// Note that this function will call itself recursively if recurse is true
+static void
+show_cache_dir(const inmem_t & a_nod, const inmem_dir_t * dirp) noexcept
+{
+    pr_err(-1, "<< directory: {}/{}, depth={} >>\n", dirp->par_pt_s,
+           dirp->filename, dirp->depth);
+    pr_err(5, "    &inmem_t: {:p}\n", (void *)&a_nod);
+    a_nod.debug();
+}
+
+// When recurse is true, the whole tree below a_nod is shown, depth first
 static void
 show_cache(const inmem_t & a_nod, bool recurse,
            const struct opts_t * op) noexcept
@@ -2778,44 +4632,43 @@ show_cache(const inmem_t & a_nod, bool recurse,
         pr_err(-1, "\n");       // blank line separator
         return;
     }
-    // pr_err(-1, "\n");        // blank line separator
-    pr_err(-1, "<< directory: {}/{}, depth={} >>\n", dirp->par_pt_s,
-           dirp->filename, dirp->depth);
-    pr_err(5, "    &inmem_t: {:p}\n", (void *)&a_nod);
-    a_nod.debug();
+    show_cache_dir(a_nod, dirp);
+    if (! recurse) {
+        for (const auto & subd : dirp->sdirs_sp->sdir_v) {
+            show_cache_not_dir(subd, op);
+            pr_err(-1, "\n");   // blank line separator
+        }
+        return;
+    }
+    // each directory being shown and the index of its next entry
+    std::vector<std::pair<const inmem_dir_t *, size_t>> stk { {dirp, 0} };
 
-    for (const auto & subd : dirp->sdirs_sp->sdir_v) {
-        const auto * cdirp { std::get_if<inmem_dir_t>(&subd) };
+    while (! stk.empty()) {
+        auto & [c_dirp, k] { stk.back() };
+        const auto & sdir_v { c_dirp->sdirs_sp->sdir_v };
 
-        if (recurse) {
-            if (cdirp) {
-                show_cache(subd, recurse, op);
+        if (k >= sdir_v.size()) {
+            stk.pop_back();
+            if (! stk.empty())
                 pr_err(-1, " << return to directory: {}/{} >>\n",
-                       dirp->par_pt_s, dirp->filename);
-            } else {
-                pr_err(-1, "{}:\n", __func__);
-                subd.debug();
-                pr_err(5, "    &inmem_t: {:p}\n", (void *)&subd);
-                pr_err(-1, "\n");       // blank line separator
-            }
+                       stk.back().first->par_pt_s,
+                       stk.back().first->filename);
+            continue;
+        }
+        const auto & subd { sdir_v[k++] };
+
+        if (const auto * cdirp { std::get_if<inmem_dir_t>(&subd) }) {
+            show_cache_dir(subd, cdirp);
+            stk.emplace_back(cdirp, 0);
         } else {
-            show_cache_not_dir(subd, op);
-            pr_err(-1, "\n");   // blank line separator
+            pr_err(-1, "{}:\n", __func__);
+            subd.debug();
+            pr_err(5, "    &inmem_t: {:p}\n", (void *)&subd);
+            pr_err(-1, "\n");       // blank line separator
         }
     }
 }
 
-// Transforms a source path to the corresponding destination path
-static sstring
-transform_src_pt2dst(const sstring & src_pt_s,
-                     const struct opts_t * op) noexcept
-{
-    if (src_pt_s.size() < op->mutp->starting_src_sz)
-        return "";
-    return s(op->destination_pt) +
-       sstring(src_pt_s.begin() + op->mutp->starting_src_sz, src_pt_s.end());
-}
-
 static std::error_code
 unroll_cache_not_dir(const sstring & s_pt_s, const sstring & d_pt_s,
                      const inmem_t & a_nod, const struct opts_t * op) noexcept
@@ -2870,7 +4723,8 @@ unroll_cache_not_dir(const sstring & s_pt_s, const sstring & d_pt_s,
         if (cregp->always_use_contents || (op->cache_op_num > 1))
             res = xfr_reg_inmem2file(*cregp, d_pt_s, op);
         else if (op->cache_op_num == 1)
-            res = xfr_reg_file2file(s_pt_s, d_pt_s, op);
+            res = xfr_reg_file2file(s_pt_s, cregp->shstat.st_dev, d_pt_s,
+                                    op);
         if (res) {
             ec.assign(res, std::system_category());
             pr_err(4, "{}: failed to write dst regular file: {}{}\n",
@@ -2899,7 +4753,7 @@ unroll_cache_is_dir(const sstring & dst_pt_s, const inmem_dir_t * dirp,
             ++q->num_dir_d_fail;
             pr_err(1, "{}: create_directory({}), depth={} failed{}\n",
                    __func__, dst_pt_s, dirp->depth, l(ec));
-        } else if (dst_pt_s != op->destination_pt) {
+        } else if (dst_pt_s != op->destination_pt.native()) {
             ++q->num_dir_d_exists;
             pr_err(2, "{}, depth={}: exists so create_directory() ignored\n",
                    dst_pt_s, dirp->depth);
@@ -2909,56 +4763,76 @@ unroll_cache_is_dir(const sstring & dst_pt_s, const inmem_dir_t * dirp,
     return ec;
 }
 
-// Unroll cache into the destination. This function calls itself recursively.
-// This is the last pass (second or third) when the --cache or --prune=
-// option is used.
+// Unroll cache into the destination, depth first, keeping the directories
+// being unrolled on an explicit stack. On entry s_bld and d_bld hold the
+// source and destination paths of a_nod and they are restored to that on
+// exit. So each node costs one push() and one pop() on each rather than
+// having its paths built from scratch. A directory that cannot be created
+// ends the unroll when recurse is true. This is the last pass (second or
+// third) when the --cache or --prune= option is used.
 static std::error_code
-unroll_cache(const inmem_t & a_nod, const sstring & s_par_pt_s, bool recurse,
-             const struct opts_t * op) noexcept
+unroll_cache(const inmem_t & a_nod, path_bld_t & s_bld, path_bld_t & d_bld,
+             bool recurse, const struct opts_t * op) noexcept
 {
     std::error_code ec { };
 
-    const auto sz { s_par_pt_s.size() };
-    const fs::path src_dir_pt { ((sz == 1) && (s_par_pt_s[0] == '/'))
-                                ? '/' + a_nod.get_filename()
-                                : s_par_pt_s + '/' + a_nod.get_filename() };
-    // following suppresses nuisance '/'is such as in '//sys'
-    sstring src_dir_pt_s { src_dir_pt.lexically_normal() };
-    sstring dst_dir_pt_s { transform_src_pt2dst(src_dir_pt_s, op) };
     if (op->prune_given && (a_nod.get_basep()->prune_mask == 0)) {
-        pr_err(6, "leaving unroll_cache({}){}\n", s(src_dir_pt_s), l());
+        pr_err(6, "leaving unroll_cache({}){}\n", s_bld.str(), l());
         return ec;
     }
     const inmem_dir_t * dirp { std::get_if<inmem_dir_t>(&a_nod) };
 
     if (dirp == nullptr)
-        return unroll_cache_not_dir(src_dir_pt_s, dst_dir_pt_s, a_nod, op);
+        return unroll_cache_not_dir(s_bld.str(), d_bld.str(), a_nod, op);
 
-    ec = unroll_cache_is_dir(dst_dir_pt_s, dirp, op);
+    ec = unroll_cache_is_dir(d_bld.str(), dirp, op);
     if (ec)
         return ec;
+    // each directory being unrolled and the index of its next entry. All
+    // but the first have had their filename pushed on s_bld and d_bld
+    std::vector<std::pair<const inmem_dir_t *, size_t>> stk { {dirp, 0} };
+
+    while (! stk.empty()) {
+        auto & [c_dirp, k] { stk.back() };
+        const auto & sdir_v { c_dirp->sdirs_sp->sdir_v };
+
+        if (k >= sdir_v.size()) {
+            stk.pop_back();
+            if (! stk.empty()) {
+                s_bld.pop();
+                d_bld.pop();
+            }
+            continue;
+        }
+        const auto & subd { sdir_v[k++] };
 
-    for (const auto & subd : dirp->sdirs_sp->sdir_v) {
         if (op->prune_given && (subd.get_basep()->prune_mask == 0))
             continue;
         const auto * cdirp { std::get_if<inmem_dir_t>(&subd) };
-
-        if (cdirp && recurse) {
-            ec = unroll_cache(subd, src_dir_pt_s, recurse, op);
-            if (ec)
-                break;
+        const auto & fn { subd.get_basep()->filename };  // no copy
+
+        s_bld.push(fn);
+        d_bld.push(fn);
+        if (cdirp) {
+            ec = unroll_cache_is_dir(d_bld.str(), cdirp, op);
+            if (ec && recurse) {
+                for (size_t j { }; j < stk.size(); ++j) {
+                    s_bld.pop();
+                    d_bld.pop();
+                }
+                return ec;
+            }
+            ec.clear();
+            if (recurse) {
+                stk.emplace_back(cdirp, 0);
+                continue;       // popped once its entries are done
+            }
         } else {
-            const auto & fn {subd.get_filename() };
-            sstring s_d_pt_s { src_dir_pt_s + '/' + fn };
-            sstring d_d_pt_s { dst_dir_pt_s + '/' + fn };
-
-            if (cdirp)
-                ec = unroll_cache_is_dir(d_d_pt_s, cdirp, op);
-            else
-                ec = unroll_cache_not_dir(s_d_pt_s, d_d_pt_s, subd, op);
-            if (ec)
-                ec.clear();
+            ec = unroll_cache_not_dir(s_bld.str(), d_bld.str(), subd, op);
+            ec.clear();
         }
+        s_bld.pop();
+        d_bld.pop();
     }
     return ec;
 }
@@ -2986,7 +4860,7 @@ prune_prop_symlink(const inmem_symlink_t * csymp,
         ++q->num_prune_sym_pt_err;
         return false;
     }
-    if (path_contains_canon(op->source_pt, target_c)) {
+    if (path_contains_canon(op->source_pt.native(), target_c.native())) {
         bool at_src_rt { };
         fs::path p_target { target_c.parent_path() };
         std::pair<inmem_dir_t *, inmem_regular_t *> res { };
@@ -3058,31 +4932,20 @@ prune_prop_reg(const inmem_regular_t * a_regp, const sstring & s_par_pt_s,
     }
 }
 
-// This is the main function of pass 2 active when the --prune= option is
-// given. Prune propagate (for a directory) searches for prune_exact marks
-// (that were set in pass 1). For each match, additionally marks are added
-// up the in-memory tree (i.e. toward the root). These are styled as
-// 'prune_up_chain' marks. Also all the nodes in the sub-tree below each
-// match are styled as 'prune_all_below' marks.
-// Expects a_nod to be a directory. s_par_pt_s is the parent path of a_nod .
-static void
-prune_prop_dir(const inmem_dir_t * a_dirp, const sstring & s_par_pt_s,
-               bool in_prune, const struct opts_t * op) noexcept
+// Called by prune_prop_dir() on reaching directory a_dirp whose parent path
+// is s_par_pt_s. Marks a_dirp and sets in_prune if the directory's contents
+// are to be pruned (kept). Returns false if its contents need no visit.
+static bool
+prune_prop_dir_enter(const inmem_dir_t * a_dirp, const sstring & s_par_pt_s,
+                     bool & in_prune, const struct opts_t * op) noexcept
 {
-    bool at_src_rt { };
-    // bool start_in_prune { };
+    const bool at_src_rt { static_cast<bool>(a_dirp->is_root) };
     std::error_code ec { };
     struct stats_t * q { &op->mutp->stats };
-    sstring src_dir_pt_s { s_par_pt_s };
-    const sstring & a_dir_fn_s { a_dirp->filename };
 
-    if (a_dirp->is_root)
-        at_src_rt = true;
-    else
-        src_dir_pt_s += '/' + a_dir_fn_s;
     if (in_prune) {
         if (a_dirp->prune_mask & prune_all_below)
-            return;
+            return false;
         if (a_dirp->prune_mask == 0)
             ++q->num_pruned_node;
         if (! at_src_rt) {
@@ -3092,7 +4955,7 @@ prune_prop_dir(const inmem_dir_t * a_dirp, const sstring & s_par_pt_s,
                 prune_mark_up_chain(s_par_pt_s, op, ec);
                 if (ec) {
                     ++q->num_prune_err;
-                    return;
+                    return false;
                 }
             }
         }
@@ -3106,25 +4969,75 @@ prune_prop_dir(const inmem_dir_t * a_dirp, const sstring & s_par_pt_s,
                 prune_mark_up_chain(s_par_pt_s, op, ec);
                 if (ec) {
                     ++q->num_prune_err;
-                    return;
+                    return false;
                 }
             }
         }
     }
+    return true;
+}
+
+// This is the main function of pass 2 active when the --prune= option is
+// given. Prune propagate (for a directory) searches for prune_exact marks
+// (that were set in pass 1). For each match, additionally marks are added
+// up the in-memory tree (i.e. toward the root). These are styled as
+// 'prune_up_chain' marks. Also all the nodes in the sub-tree below each
+// match are styled as 'prune_all_below' marks.
+// Expects a_nod to be a directory. s_par_pt_s is the parent path of a_nod .
+// The sub-tree is visited depth first with an explicit stack.
+static void
+prune_prop_dir(const inmem_dir_t * a_dirp, const sstring & s_par_pt_s,
+               bool in_prune, const struct opts_t * op) noexcept
+{
+    // a directory being visited, its path, whether it is in a pruned
+    // sub-tree and the index of its next entry
+    struct prune_frm_t {
+        const inmem_dir_t * dirp;
+        sstring dir_pt_s;
+        bool in_prune;
+        size_t k;
+    };
+    std::error_code ec { };
+    struct stats_t * q { &op->mutp->stats };
+    std::vector<prune_frm_t> stk;
+
+    if (! prune_prop_dir_enter(a_dirp, s_par_pt_s, in_prune, op))
+        return;
+    stk.push_back({a_dirp, a_dirp->is_root ? s_par_pt_s
+                                  : s_par_pt_s + '/' + a_dirp->filename,
+                   in_prune, 0});
+
+    while (! stk.empty()) {
+        prune_frm_t & frm { stk.back() };
+        auto & sdir_v { frm.dirp->sdirs_sp->sdir_v };
 
-    for (auto & subd : a_dirp->sdirs_sp->sdir_v) {
+        if (frm.k >= sdir_v.size()) {
+            stk.pop_back();
+            continue;
+        }
+        auto & subd { sdir_v[frm.k++] };
+        const bool l_in_prune { frm.in_prune };
+        const sstring & src_dir_pt_s { frm.dir_pt_s };
         inmem_base_t * sibp = subd.get_basep();
+
         if (sibp->prune_mask & prune_all_below)
             continue;       // all done here and below
-        else if (in_prune) {
+        else if (l_in_prune) {
             if (sibp->prune_mask & prune_up_chain)
                 sibp->prune_mask &= ~prune_up_chain;    // clear it
         }
         if (const auto * dirp { std::get_if<inmem_dir_t>(&subd) }) {
-            prune_prop_dir(dirp, src_dir_pt_s, in_prune, op);
+            bool c_in_prune { l_in_prune };
+
+            if (prune_prop_dir_enter(dirp, src_dir_pt_s, c_in_prune, op)) {
+                sstring c_pt_s { src_dir_pt_s + '/' + dirp->filename };
+
+                // frm and src_dir_pt_s are not used after this
+                stk.push_back({dirp, std::move(c_pt_s), c_in_prune, 0});
+            }
         } else if (const auto * csymp
                             { std::get_if<inmem_symlink_t>(&subd) }) {
-            if (in_prune) {
+            if (l_in_prune) {
                 if (! prune_prop_symlink(csymp, src_dir_pt_s, op))
                     continue;
             } else if (csymp->prune_mask & prune_exact) {
@@ -3135,13 +5048,13 @@ prune_prop_dir(const inmem_dir_t * a_dirp, const sstring & s_par_pt_s,
                 prune_mark_up_chain(src_dir_pt_s, op, ec);
             }
         } else if (const auto * cregp {std::get_if<inmem_regular_t>(&subd) })
-            prune_prop_reg(cregp, src_dir_pt_s, in_prune, op);
-        else  if (in_prune) {
+            prune_prop_reg(cregp, src_dir_pt_s, l_in_prune, op);
+        else  if (l_in_prune) {
             if (sibp->prune_mask == 0)
                 ++q->num_pruned_node;
             sibp->prune_mask |= prune_all_below;
         }
-    }       // end of range based loop on sdir_v
+    }
 }
 
 // Called from main(). Starts single pass clone/copy when neither the --cache
@@ -3184,30 +5097,790 @@ do_clone(const struct opts_t * op) noexcept
     char b[32];
     snprintf(b, sizeof(b), "%d.%03d", static_cast<int>(secs),
              static_cast<int>(ms_remainder));
-    std:: cout << "Elapsed time: " << b << " seconds\n";
+    (omutp->tm_osp ? *omutp->tm_osp : scout) << "Elapsed time: " << b
+                                               << " seconds\n";
 
-    if (op->want_stats > 0)
+    if ((op->want_stats > 0) && (! omutp->tm_osp))
         show_stats(op);
     return ec;
 }
 
-// Called from main(). Starts pass 1 (caching) when --cache or --prune=
-// option is given. Also invokes pass 2 if op->prune_given and then invokes
-// the unroll (in-memory tree rolled out into the destination) which is the
-// final pass.
-static std::error_code
-do_cache(const inmem_t & src_rt_cache, const struct opts_t * op) noexcept
+// Writes sv as a CSV field, quoted if it holds a comma, quote or newline.
+static void
+csv_field(std::ostream & os, std::string_view sv) noexcept
 {
-    int pass { 1 };
-    std::error_code ec { };
-    uint8_t * sbrk_p { static_cast<uint8_t *>(sbrk(0)) };
-    struct mut_opts_t * omutp { op->mutp };
-    struct stats_t * q { &omutp->stats };
-    auto ch_start { chron::steady_clock::now() };
+    if (sv.find_first_of(",\"\r\n") == sv.npos) {
+        os << sv;
+        return;
+    }
+    os << '"';
+    for (char c : sv) {
+        if (c == '"')
+            os << '"';
+        os << c;
+    }
+    os << '"';
+}
 
-    q->num_node = 1;    // count the source root node
-    pr_err(5, "\n{}: >> start of pass {} (cache source)\n", __func__, pass);
-    ec = cache_src(omutp->cache_rt_dirp, op->source_pt, op);
+// (attribute name, its cached regular file) pairs of one directory
+using col_attr_v_t = std::vector<std::pair<sstring, const inmem_regular_t *>>;
+
+// Appends the regular files of dirp to attr_v, each named by its path
+// relative to the sibling directory (pre_s) whose table is being built.
+// Then does the same for each sub-directory of dirp, down to sub_depth
+// levels, so (e.g.) /sys/block/*/queue/* are columns of /sys/block/* .
+static void
+col_attrs(const inmem_dir_t * dirp, const sstring & pre_s, int sub_depth,
+          col_attr_v_t & attr_v, const struct opts_t * op) noexcept
+{
+    for (const auto & subd : dirp->sdirs_sp->sdir_v) {
+        const inmem_base_t * bp { subd.get_basep() };
+
+        if (op->prune_given && (bp->prune_mask == 0))
+            continue;
+        if (const auto * cregp { std::get_if<inmem_regular_t>(&subd) })
+            attr_v.emplace_back(pre_s + bp->filename, cregp);
+        else if (const auto * cdirp { std::get_if<inmem_dir_t>(&subd) };
+                 cdirp && (sub_depth > 0))
+            col_attrs(cdirp, pre_s + bp->filename + "/", sub_depth - 1,
+                      attr_v, op);
+    }
+}
+
+// Writes one table of --columnar=CDIR as CSV to tfn: a header line of
+// 'name' then the attribute names (the same for every row), then one line
+// per sibling directory. Returns 0 or an errno value.
+static int
+col_write_table(const sstring & tfn, const std::vector<sstring> & row_nm_v,
+                const std::vector<col_attr_v_t> & row_attr_vv) noexcept
+{
+    uint8_t a_b[num_render_max];
+    std::ofstream ofs(tfn, std::ios::trunc);
+
+    if (! ofs)
+        return errno ? errno : EIO;
+    ofs << "name";
+    for (const auto & [nm, cregp] : row_attr_vv[0]) {
+        ofs << ',';
+        csv_field(ofs, nm);
+    }
+    ofs << '\n';
+    for (size_t k { }; k < row_nm_v.size(); ++k) {
+        csv_field(ofs, row_nm_v[k]);
+        for (const auto & [nm, cregp] : row_attr_vv[k]) {
+            const auto c_sp { cregp->get_contents(a_b) };
+            std::string_view sv { reinterpret_cast<const char *>(c_sp.data()),
+                                  c_sp.size() };
+
+            if ((! sv.empty()) && (sv.back() == '\n'))
+                sv.remove_suffix(1);
+            ofs << ',';
+            csv_field(ofs, sv);
+        }
+        ofs << '\n';
+    }
+    ofs.close();
+    return ofs ? 0 : EIO;
+}
+
+// The sub-directories of dirp are grouped by their schema: the sorted names
+// of their attributes (see col_attrs()). Each group of at least
+// col_min_rows siblings is written as a table in c_dir_s, the directory
+// under CDIR corresponding to dirp: the largest group to columns.csv,
+// others to columns2.csv and so on.
+static void
+col_export_dir(const inmem_dir_t * dirp, const sstring & c_dir_s,
+               const struct opts_t * op) noexcept
+{
+    struct stats_t * q { &op->mutp->stats };
+    std::vector<sstring> nm_v;
+    std::vector<col_attr_v_t> attr_vv;
+    std::map<std::vector<sstring>, std::vector<size_t>> schema_m;
+
+    for (const auto & subd : dirp->sdirs_sp->sdir_v) {
+        const auto * cdirp { std::get_if<inmem_dir_t>(&subd) };
+
+        if ((cdirp == nullptr) ||
+            (op->prune_given && (cdirp->prune_mask == 0)))
+            continue;
+        col_attr_v_t attr_v;
+
+        col_attrs(cdirp, sstring(), col_sub_depth, attr_v, op);
+        if (attr_v.empty())
+            continue;
+        std::ranges::sort(attr_v, { }, &col_attr_v_t::value_type::first);
+        std::vector<sstring> schema;
+
+        schema.reserve(attr_v.size());
+        for (const auto & [nm, cregp] : attr_v)
+            schema.push_back(nm);
+        schema_m[std::move(schema)].push_back(nm_v.size());
+        nm_v.push_back(cdirp->filename);
+        attr_vv.push_back(std::move(attr_v));
+    }
+    std::vector<const std::vector<size_t> *> grp_v;
+
+    for (const auto & [schema, ind_v] : schema_m) {
+        if (ind_v.size() >= col_min_rows)
+            grp_v.push_back(&ind_v);
+    }
+    std::ranges::stable_sort(grp_v, std::ranges::greater { },
+                             [](const auto * p) { return p->size(); });
+    for (unsigned int g { }; g < grp_v.size(); ++g) {
+        std::error_code ec { };
+        std::vector<sstring> row_nm_v;
+        std::vector<col_attr_v_t> row_attr_vv;
+
+        for (size_t k : *grp_v[g]) {
+            row_nm_v.push_back(nm_v[k]);
+            row_attr_vv.push_back(attr_vv[k]);
+        }
+        fs::create_directories(c_dir_s, ec);
+        const sstring tfn { c_dir_s + (g ? "/columns" +
+                                std::to_string(g + 1) + ".csv"
+                                             : "/columns.csv") };
+        int res { ec ? ec.value()
+                     : col_write_table(tfn, row_nm_v, row_attr_vv) };
+
+        if (res) {
+            pr_err(2, "{}: {}{}\n", __func__, tfn,
+                   l(std::error_code(res, std::system_category())));
+            ++q->num_col_err;
+            continue;
+        }
+        ++q->num_col_table;
+        q->num_col_row += row_nm_v.size();
+    }
+}
+
+// Pass of --columnar=CDIR over the in-memory tree: col_export_dir() is
+// applied to dirp, whose directory under CDIR is c_bld, then to each
+// directory below it (pre-order), using an explicit stack.
+static void
+col_export(const inmem_dir_t * dirp, path_bld_t & c_bld,
+           const struct opts_t * op) noexcept
+{
+    // each directory being visited and the index of its next entry. All
+    // but the first have had their filename pushed on c_bld
+    std::vector<std::pair<const inmem_dir_t *, size_t>> stk { {dirp, 0} };
+
+    col_export_dir(dirp, c_bld.str(), op);
+    while (! stk.empty()) {
+        auto & [c_dirp, k] { stk.back() };
+        const auto & sdir_v { c_dirp->sdirs_sp->sdir_v };
+
+        if (k >= sdir_v.size()) {
+            stk.pop_back();
+            if (! stk.empty())
+                c_bld.pop();
+            continue;
+        }
+        const auto * cdirp { std::get_if<inmem_dir_t>(&sdir_v[k++]) };
+
+        if ((cdirp == nullptr) ||
+            (op->prune_given && (cdirp->prune_mask == 0)))
+            continue;
+        c_bld.push(cdirp->filename);
+        col_export_dir(cdirp, c_bld.str(), op);
+        stk.emplace_back(cdirp, 0);     // popped once its entries are done
+    }
+}
+
+// Sets one metadata field of a --preserve node, given res from the system
+// call doing it. Returns false if that node should be skipped. ENOENT is
+// not an error: that node was not placed in DPATH (e.g. excluded).
+static bool
+meta_res(int res, bool & ok, struct stats_t * q) noexcept
+{
+    if (res == 0)
+        return true;
+    if (errno == ENOENT)
+        return false;
+    if (ok)
+        ++q->num_meta_err;
+    ok = false;
+    return true;
+}
+
+// Final pass of --preserve: gives each node placed in DPATH the owner (if
+// run as root), permissions (not symlinks) and access and modification
+// times its source node had. The deepest nodes are done first and, at
+// each depth, siblings are done together so each parent directory is
+// opened once and the calls use its fd. Also since a directory is done
+// after its contents, setting its times and (e.g. read-only) permissions
+// is not undone by, or does not prevent, work on what is below it.
+static void
+meta_apply(const struct opts_t * op) noexcept
+{
+    const int dir_flags { O_RDONLY | O_DIRECTORY | O_CLOEXEC };
+    const bool as_root { geteuid() == 0 };
+    struct mut_opts_t * omutp { op->mutp };
+    struct stats_t * q { &omutp->stats };
+    int d_rt_fd { open(op->destination_pt.c_str(), dir_flags) };
+    int dfd { -1 };
+    std::string_view par_sv { "?" };    // no parent matches this
+
+    if (d_rt_fd < 0) {
+        pr_err(-1, "{}: unable to open DPATH{}\n", __func__,
+               l(std::error_code(errno, std::system_category())));
+        return;
+    }
+    // names sharing a parent are adjacent when sorted
+    std::ranges::sort(omutp->meta_v, [](const meta_rec_t & a,
+                                        const meta_rec_t & b) {
+        return (a.depth != b.depth) ? (a.depth > b.depth)
+                                    : (a.rel_s < b.rel_s);
+    });
+    for (const auto & rec : omutp->meta_v) {
+        const auto pos { rec.rel_s.rfind('/') };
+        const std::string_view this_par_sv
+                        { std::string_view(rec.rel_s).substr(0, pos) };
+        const char * fn { rec.rel_s.c_str() + pos + 1 };
+        const struct timespec ts[2] { rec.st_atim, rec.st_mtim };
+        bool ok { true };
+
+        if (this_par_sv != par_sv) {
+            par_sv = this_par_sv;
+            if (dfd >= 0)
+                close(dfd);
+            const sstring par_s { par_sv.empty() ? sstring(".")
+                                                 : sstring(par_sv.substr(1)) };
+
+            dfd = openat(d_rt_fd, par_s.c_str(), dir_flags);
+            if ((dfd < 0) && (errno != ENOENT))
+                ++q->num_meta_err;
+        }
+        if (dfd < 0)
+            continue;
+        if (as_root &&
+            (! meta_res(fchownat(dfd, fn, rec.st_uid, rec.st_gid,
+                                 AT_SYMLINK_NOFOLLOW), ok, q)))
+            continue;
+        if ((! S_ISLNK(rec.st_mode)) &&
+            (! meta_res(fchmodat(dfd, fn, rec.st_mode & 07777, 0), ok, q)))
+            continue;
+        if (! meta_res(utimensat(dfd, fn, ts, AT_SYMLINK_NOFOLLOW), ok, q))
+            continue;
+        if (ok)
+            ++q->num_meta_set;
+    }
+    if (dfd >= 0)
+        close(dfd);
+    close(d_rt_fd);
+    omutp->meta_v.clear();
+    omutp->meta_v.shrink_to_fit();
+}
+
+// --squashfs=SQIMG writes the in-memory tree as a SquashFS 4.0 image (see
+// Documentation/filesystems/squashfs.rst in the kernel source). All values
+// are little endian. Inodes, directory listings and the tables are held in
+// metadata blocks of 8 KiB, file data in blocks of sqfs_blk_sz bytes. The
+// tail of a file shorter than that is packed with other tails into a
+// fragment block, so a sysfs attribute of a few bytes costs its inode and
+// little else.
+static const uint32_t sqfs_magic { 0x73717368 };
+static const uint32_t sqfs_blk_sz { 128 * 1024 };
+static const uint16_t sqfs_blk_log { 17 };
+static const size_t sqfs_meta_sz { 8192 };
+static const size_t sqfs_sb_sz { 96 };          // superblock
+static const size_t sqfs_dir_cnt_max { 256 };   // entries per listing header
+static const uint32_t sqfs_no_frag { 0xffffffff };
+static const uint32_t sqfs_raw_blk { 1U << 24 };    // data held uncompressed
+static const uint16_t sqfs_raw_meta { 0x8000 };     // as above, metadata
+static const uint16_t sqfs_comp_zlib { 1 };
+static const uint16_t sqfs_fl_dups { 0x40 };        // shared file data
+static const uint16_t sqfs_fl_no_xattrs { 0x200 };
+
+// inode types, basic then extended; directory entries hold the basic type
+enum sqfs_ino_e : uint16_t {
+    sqfs_ino_dir = 1,
+    sqfs_ino_reg,
+    sqfs_ino_sym,
+    sqfs_ino_blk,
+    sqfs_ino_chr,
+    sqfs_ino_ldir = 8,
+    sqfs_ino_lreg,
+};
+
+// Appends the nb low order bytes of val to v, little endian
+static void
+sqfs_put(std::vector<uint8_t> & v, uint64_t val, int nb) noexcept
+{
+    for (int k { }; k < nb; ++k, val >>= 8)
+        v.push_back(static_cast<uint8_t>(val));
+}
+
+// Places a compressed copy of [bp, bp + n) in out. Returns false, with out
+// empty, when that is no smaller (or when built without zlib) in which case
+// the caller stores the bytes as they are.
+static bool
+sqfs_compress([[maybe_unused]] const uint8_t * bp,
+              [[maybe_unused]] size_t n, std::vector<uint8_t> & out) noexcept
+{
+#ifdef HAVE_LIBZ
+    uLongf o_n { compressBound(n) };
+
+    out.resize(o_n);
+    if ((compress2(out.data(), &o_n, bp, n, Z_DEFAULT_COMPRESSION) ==
+         Z_OK) && (o_n < n)) {
+        out.resize(o_n);
+        return true;
+    }
+#endif
+    out.clear();
+    return false;
+}
+
+// One metadata table of the image. Bytes are added to cur and each full
+// 8 KiB block is moved to out behind a 2 byte header. A reference to the
+// next byte added is the offset of its block in out, shifted up 16 bits,
+// plus its offset within that block.
+struct sqfs_meta_t {
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> cur;
+    std::vector<uint64_t> blk_v;    // offset in out of each block
+
+    uint64_t ref() const noexcept { return (out.size() << 16) | cur.size(); }
+
+    void add(const std::vector<uint8_t> & v) noexcept;
+
+    void flush() noexcept;
+};
+
+void
+sqfs_meta_t::add(const std::vector<uint8_t> & v) noexcept
+{
+    for (size_t k { }; k < v.size(); ) {
+        const size_t n { std::min(v.size() - k, sqfs_meta_sz - cur.size()) };
+
+        cur.insert(cur.end(), v.begin() + k, v.begin() + k + n);
+        k += n;
+        if (cur.size() == sqfs_meta_sz)
+            flush();
+    }
+}
+
+void
+sqfs_meta_t::flush() noexcept
+{
+    std::vector<uint8_t> z;
+
+    if (cur.empty())
+        return;
+    blk_v.push_back(out.size());
+    if (sqfs_compress(cur.data(), cur.size(), z)) {
+        sqfs_put(out, z.size(), 2);
+        out.insert(out.end(), z.begin(), z.end());
+    } else {
+        sqfs_put(out, cur.size() | sqfs_raw_meta, 2);
+        out.insert(out.end(), cur.begin(), cur.end());
+    }
+    cur.clear();
+}
+
+// A directory of the image. Directories are listed breadth first so the
+// entries of each one get consecutive inode numbers.
+struct sqfs_dir_t {
+    const inmem_dir_t * dirp;
+    uint32_t ino;
+    uint32_t par_ino;
+    uint32_t ino_base { };      // inode number of ent_v[0]
+    uint32_t nlink { 2 };
+    uint64_t ref { };           // of its inode, once written
+    // entries sorted by filename, each with its index in the directory
+    // vector (directory) or the data vector (regular file)
+    std::vector<std::pair<const inmem_t *, uint32_t>> ent_v { };
+};
+
+// File data, shared by all regular files with the same contents. The full
+// blocks are compression jobs [job_first, job_first + size / sqfs_blk_sz)
+// and any tail is at frag_off in fragment frag.
+struct sqfs_data_t {
+    const uint8_t * bp;
+    uint32_t sz;
+    uint32_t frag { sqfs_no_frag };
+    uint32_t frag_off { };
+    size_t job_first { };
+    uint64_t start { };         // image offset of the first block
+};
+
+// Writes the sub-tree of rt_dirp, less nodes not marked with --prune=, to
+// SQIMG (fn). Symlinks, regular files and device nodes become inodes of
+// those types while fifos and sockets are left out, as the unroll does.
+// Regular file contents are those cached (so --cache given twice) and
+// files with the same contents share data blocks. Data and fragment blocks
+// are compressed on up to NJ threads (def: one per CPU). Owners are the
+// user running this utility, times are when the image is written.
+static std::error_code
+sqfs_export(const inmem_dir_t * rt_dirp, const char * fn,
+            const struct opts_t * op) noexcept
+{
+    struct mut_opts_t * omutp { op->mutp };
+    struct stats_t * q { &omutp->stats };
+    // each clone of do_multi_src() already has a thread of its own
+    const unsigned int num_thr
+                { omutp->tm_osp ? 1U :
+                  (op->jobs_given ? op->jobs
+                        : std::max(std::thread::hardware_concurrency(), 1U)) };
+    const uint32_t now { static_cast<uint32_t>(time(nullptr)) };
+    std::vector<sqfs_dir_t> dir_v;
+    std::vector<sqfs_data_t> data_v;
+    std::vector<std::vector<uint8_t>> frag_v;
+    std::vector<std::span<const uint8_t>> job_v;
+    std::unordered_map<uint64_t, uint32_t> data_m;  // hash --> data_v index
+    uint32_t next_ino { 2 };
+    std::error_code ec { };
+
+    // Pass over the tree: number the inodes and gather file data into
+    // blocks and fragments, once per distinct contents.
+    dir_v.push_back({ rt_dirp, 1, 0 });
+    for (size_t d { }; d < dir_v.size(); ++d) {
+        std::vector<std::pair<const inmem_t *, uint32_t>> ent_v;
+
+        for (const auto & subd : dir_v[d].dirp->sdirs_sp->sdir_v) {
+            if (op->prune_given && (subd.get_basep()->prune_mask == 0))
+                continue;
+            if (std::holds_alternative<inmem_other_t>(subd) ||
+                std::holds_alternative<inmem_fifo_socket_t>(subd))
+                continue;
+            ent_v.emplace_back(&subd, 0);
+        }
+        std::ranges::sort(ent_v, { }, [](const auto & pr) -> const sstring &
+                                { return pr.first->get_basep()->filename; });
+        dir_v[d].ino_base = next_ino;
+        next_ino += ent_v.size();
+        for (uint32_t k { }; k < ent_v.size(); ++k) {
+            const inmem_t & nod { *ent_v[k].first };
+
+            if (const auto * cdirp { std::get_if<inmem_dir_t>(&nod) }) {
+                ent_v[k].second = dir_v.size();
+                ++dir_v[d].nlink;
+                dir_v.push_back({ cdirp, dir_v[d].ino_base + k,
+                                  dir_v[d].ino });
+                continue;
+            }
+            const auto * cregp { std::get_if<inmem_regular_t>(&nod) };
+
+            if (cregp == nullptr)
+                continue;
+            uint8_t num_b[num_render_max];
+            const auto c_sp { cregp->get_contents(num_b) };
+            const uint64_t h { cregp->contents_hash ? cregp->contents_hash
+                               : cpf_hash::hash64(c_sp.data(), c_sp.size()) };
+            const size_t num_full { c_sp.size() / sqfs_blk_sz };
+            const size_t tail { c_sp.size() % sqfs_blk_sz };
+
+            if (const auto it { data_m.find(h) }; it != data_m.end()) {
+                const sqfs_data_t & dat { data_v[it->second] };
+
+                if ((dat.sz == c_sp.size()) &&
+                    ((num_full == 0) ||
+                     (0 == memcmp(dat.bp, c_sp.data(),
+                                  num_full * sqfs_blk_sz))) &&
+                    ((tail == 0) ||
+                     (0 == memcmp(frag_v[dat.frag].data() + dat.frag_off,
+                                  c_sp.data() + num_full * sqfs_blk_sz,
+                                  tail)))) {
+                    ent_v[k].second = it->second;
+                    ++q->num_sqfs_shared;
+                    continue;
+                }
+            }
+            sqfs_data_t dat { c_sp.data(),
+                              static_cast<uint32_t>(c_sp.size()) };
+
+            dat.job_first = job_v.size();
+            for (size_t j { }; j < num_full; ++j)
+                job_v.push_back(c_sp.subspan(j * sqfs_blk_sz, sqfs_blk_sz));
+            if (tail > 0) {
+                if (frag_v.empty() ||
+                    (frag_v.back().size() + tail > sqfs_blk_sz)) {
+                    frag_v.emplace_back();
+                    frag_v.back().reserve(sqfs_blk_sz);
+                }
+                dat.frag = frag_v.size() - 1;
+                dat.frag_off = frag_v.back().size();
+                frag_v.back().insert(frag_v.back().end(),
+                                     c_sp.end() - tail, c_sp.end());
+            }
+            ent_v[k].second = data_v.size();
+            data_m.try_emplace(h, data_v.size());  // first one kept
+            data_v.push_back(dat);
+        }
+        dir_v[d].ent_v = std::move(ent_v);
+    }
+    const uint32_t num_ino { next_ino - 1 };
+    const size_t num_data_job { job_v.size() };
+
+    for (const auto & frag : frag_v)
+        job_v.emplace_back(frag.data(), frag.size());
+    std::vector<std::vector<uint8_t>> z_v(job_v.size());
+
+    run_workers(num_thr, job_v.size(), [&](size_t k, unsigned int) {
+        sqfs_compress(job_v[k].data(), job_v[k].size(), z_v[k]);
+    });
+    // size word of block k: its length on disk, flagged if uncompressed
+    auto blk_word = [&](size_t k) -> uint32_t {
+        return z_v[k].empty() ? (job_v[k].size() | sqfs_raw_blk)
+                              : z_v[k].size();
+    };
+
+    FILE * fp { fopen(fn, "w") };
+    uint64_t pos { sqfs_sb_sz };
+    std::vector<uint64_t> frag_start_v;
+
+    if (fp == nullptr) {
+        ec.assign(errno, std::system_category());
+        return ec;
+    }
+    auto put_blk = [&](size_t k) {
+        const auto & z { z_v[k] };
+        const size_t n { z.empty() ? job_v[k].size() : z.size() };
+
+        if (fwrite(z.empty() ? job_v[k].data() : z.data(), 1, n, fp) != n)
+            ec.assign(errno ? errno : EIO, std::system_category());
+        pos += n;
+    };
+
+    fseeko(fp, sqfs_sb_sz, SEEK_SET);  // superblock is written last
+    for (auto & dat : data_v) {
+        dat.start = pos;
+        for (size_t j { }; j < dat.sz / sqfs_blk_sz; ++j)
+            put_blk(dat.job_first + j);
+    }
+    for (size_t f { }; f < frag_v.size(); ++f) {
+        frag_start_v.push_back(pos);
+        put_blk(num_data_job + f);
+    }
+
+    // Inode and directory tables. Directories are taken deepest first so
+    // the inodes of a directory's entries are written before its listing,
+    // which holds their references, and its listing before its inode.
+    const uint32_t euid { geteuid() };
+    const uint32_t egid { getegid() };
+    const uint16_t gid_ind { static_cast<uint16_t>((egid == euid) ? 0 : 1) };
+    sqfs_meta_t ino_tbl, dir_tbl, frag_tbl, id_tbl;
+    std::vector<uint8_t> v;
+
+    auto ino_head = [&](uint16_t typ, mode_t mode, uint32_t ino) {
+        v.clear();
+        sqfs_put(v, typ, 2);
+        sqfs_put(v, mode & 07777, 2);
+        sqfs_put(v, 0, 2);          // uid, index into id table
+        sqfs_put(v, gid_ind, 2);
+        sqfs_put(v, now, 4);
+        sqfs_put(v, ino, 4);
+    };
+
+    for (size_t d { dir_v.size() }; d-- > 0; ) {
+        sqfs_dir_t & sd { dir_v[d] };
+        const size_t num_ent { sd.ent_v.size() };
+        std::vector<uint64_t> ref_v(num_ent);
+
+        for (size_t k { }; k < num_ent; ++k) {
+            const auto & [np, ind] { sd.ent_v[k] };
+            const uint32_t ino { static_cast<uint32_t>(sd.ino_base + k) };
+
+            if (std::holds_alternative<inmem_dir_t>(*np)) {
+                ref_v[k] = dir_v[ind].ref;
+                continue;
+            }
+            ref_v[k] = ino_tbl.ref();
+            if (const auto * cregp { std::get_if<inmem_regular_t>(np) }) {
+                const sqfs_data_t & dat { data_v[ind] };
+                const mode_t perms { (cregp->shstat.st_mode | def_file_perm) &
+                                     stat_perm_mask };
+                const size_t num_blk { (dat.frag == sqfs_no_frag) ?
+                            (dat.sz + sqfs_blk_sz - 1) / sqfs_blk_sz :
+                            dat.sz / sqfs_blk_sz };
+
+                if (dat.start <= UINT32_MAX) {
+                    ino_head(sqfs_ino_reg, perms, ino);
+                    sqfs_put(v, dat.start, 4);
+                    sqfs_put(v, dat.frag, 4);
+                    sqfs_put(v, dat.frag_off, 4);
+                    sqfs_put(v, dat.sz, 4);
+                } else {
+                    ino_head(sqfs_ino_lreg, perms, ino);
+                    sqfs_put(v, dat.start, 8);
+                    sqfs_put(v, dat.sz, 8);
+                    sqfs_put(v, 0, 8);          // sparse bytes
+                    sqfs_put(v, 1, 4);          // nlink
+                    sqfs_put(v, dat.frag, 4);
+                    sqfs_put(v, dat.frag_off, 4);
+                    sqfs_put(v, sqfs_no_frag, 4);   // no xattr
+                }
+                for (size_t j { }; j < num_blk; ++j)
+                    sqfs_put(v, blk_word(dat.job_first + j), 4);
+            } else if (const auto * csymp
+                                { std::get_if<inmem_symlink_t>(np) }) {
+                const sstring & tgt { csymp->target.native() };
+
+                ino_head(sqfs_ino_sym, 0777, ino);
+                sqfs_put(v, 1, 4);
+                sqfs_put(v, tgt.size(), 4);
+                v.insert(v.end(), tgt.begin(), tgt.end());
+            } else if (const auto * cdevp
+                                { std::get_if<inmem_device_t>(np) }) {
+                const uint32_t mj { major(cdevp->st_rdev) };
+                const uint32_t mn { minor(cdevp->st_rdev) };
+
+                ino_head(cdevp->is_block_dev ? sqfs_ino_blk : sqfs_ino_chr,
+                         cdevp->shstat.st_mode, ino);
+                sqfs_put(v, 1, 4);
+                // as the kernel's new_encode_dev()
+                sqfs_put(v, (mn & 0xff) | (mj << 8) | ((mn & ~0xffU) << 12),
+                         4);
+            }
+            ino_tbl.add(v);
+        }
+        // the listing: runs of up to 256 entries whose inodes are in the
+        // same metadata block, each run after a header
+        const uint64_t lst_ref { dir_tbl.ref() };
+        size_t lst_sz { };
+
+        for (size_t k { }; k < num_ent; ) {
+            const uint64_t blk { ref_v[k] >> 16 };
+            size_t j { k };
+
+            while ((j < num_ent) && (j - k < sqfs_dir_cnt_max) &&
+                   ((ref_v[j] >> 16) == blk))
+                ++j;
+            v.clear();
+            sqfs_put(v, j - k - 1, 4);
+            sqfs_put(v, blk, 4);
+            sqfs_put(v, sd.ino_base + k, 4);
+            for (size_t i { k }; i < j; ++i) {
+                const inmem_t & nod { *sd.ent_v[i].first };
+                const sstring & nm { nod.get_basep()->filename };
+                uint16_t typ { sqfs_ino_reg };
+
+                if (std::holds_alternative<inmem_dir_t>(nod))
+                    typ = sqfs_ino_dir;
+                else if (std::holds_alternative<inmem_symlink_t>(nod))
+                    typ = sqfs_ino_sym;
+                else if (const auto * cdevp
+                                { std::get_if<inmem_device_t>(&nod) })
+                    typ = cdevp->is_block_dev ? sqfs_ino_blk : sqfs_ino_chr;
+                sqfs_put(v, ref_v[i] & 0xffff, 2);
+                sqfs_put(v, i - k, 2);      // inode number delta
+                sqfs_put(v, typ, 2);
+                sqfs_put(v, nm.size() - 1, 2);
+                v.insert(v.end(), nm.begin(), nm.end());
+            }
+            dir_tbl.add(v);
+            lst_sz += v.size();
+            k = j;
+        }
+        // file_size counts 3 bytes more than the listing, for "." and ".."
+        sd.ref = ino_tbl.ref();
+        if ((lst_sz + 3 <= UINT16_MAX) && ((lst_ref >> 16) <= UINT32_MAX)) {
+            ino_head(sqfs_ino_dir, 0755, sd.ino);
+            sqfs_put(v, lst_ref >> 16, 4);
+            sqfs_put(v, sd.nlink, 4);
+            sqfs_put(v, lst_sz + 3, 2);
+            sqfs_put(v, lst_ref & 0xffff, 2);
+            sqfs_put(v, d ? sd.par_ino : num_ino + 1, 4);
+        } else {
+            ino_head(sqfs_ino_ldir, 0755, sd.ino);
+            sqfs_put(v, sd.nlink, 4);
+            sqfs_put(v, lst_sz + 3, 4);
+            sqfs_put(v, lst_ref >> 16, 4);
+            sqfs_put(v, d ? sd.par_ino : num_ino + 1, 4);
+            sqfs_put(v, 0, 2);              // no directory index
+            sqfs_put(v, lst_ref & 0xffff, 2);
+            sqfs_put(v, sqfs_no_frag, 4);   // no xattr
+        }
+        ino_tbl.add(v);
+    }
+    for (size_t f { }; f < frag_v.size(); ++f) {
+        v.clear();
+        sqfs_put(v, frag_start_v[f], 8);
+        sqfs_put(v, blk_word(num_data_job + f), 4);
+        sqfs_put(v, 0, 4);
+        frag_tbl.add(v);
+    }
+    v.clear();
+    sqfs_put(v, euid, 4);
+    if (gid_ind)
+        sqfs_put(v, egid, 4);
+    id_tbl.add(v);
+    ino_tbl.flush();
+    dir_tbl.flush();
+    frag_tbl.flush();
+    id_tbl.flush();
+
+    // The kernel expects the tables in this order, the id table's index
+    // ending the image. Each table's index lists its metadata blocks.
+    const uint64_t ino_tbl_start { pos };
+    const uint64_t dir_tbl_start { ino_tbl_start + ino_tbl.out.size() };
+    const uint64_t frag_meta_start { dir_tbl_start + dir_tbl.out.size() };
+    const uint64_t frag_tbl_start { frag_meta_start + frag_tbl.out.size() };
+    const uint64_t id_meta_start { frag_tbl_start +
+                                   8 * frag_tbl.blk_v.size() };
+    const uint64_t id_tbl_start { id_meta_start + id_tbl.out.size() };
+    const uint64_t bytes_used { id_tbl_start + 8 * id_tbl.blk_v.size() };
+
+    v.clear();
+    v.insert(v.end(), ino_tbl.out.begin(), ino_tbl.out.end());
+    v.insert(v.end(), dir_tbl.out.begin(), dir_tbl.out.end());
+    v.insert(v.end(), frag_tbl.out.begin(), frag_tbl.out.end());
+    for (const auto off : frag_tbl.blk_v)
+        sqfs_put(v, frag_meta_start + off, 8);
+    v.insert(v.end(), id_tbl.out.begin(), id_tbl.out.end());
+    for (const auto off : id_tbl.blk_v)
+        sqfs_put(v, id_meta_start + off, 8);
+    v.resize(v.size() + ((4096 - (bytes_used % 4096)) % 4096), 0);
+    if (fwrite(v.data(), 1, v.size(), fp) != v.size())
+        ec.assign(errno ? errno : EIO, std::system_category());
+
+    v.clear();
+    sqfs_put(v, sqfs_magic, 4);
+    sqfs_put(v, num_ino, 4);
+    sqfs_put(v, now, 4);
+    sqfs_put(v, sqfs_blk_sz, 4);
+    sqfs_put(v, frag_v.size(), 4);
+    sqfs_put(v, sqfs_comp_zlib, 2);
+    sqfs_put(v, sqfs_blk_log, 2);
+    sqfs_put(v, sqfs_fl_dups | sqfs_fl_no_xattrs, 2);
+    sqfs_put(v, gid_ind + 1, 2);        // number of ids
+    sqfs_put(v, 4, 2);                  // version 4.0
+    sqfs_put(v, 0, 2);
+    sqfs_put(v, dir_v[0].ref, 8);       // root inode
+    sqfs_put(v, bytes_used, 8);
+    sqfs_put(v, id_tbl_start, 8);
+    sqfs_put(v, UINT64_MAX, 8);         // no xattr table
+    sqfs_put(v, ino_tbl_start, 8);
+    sqfs_put(v, dir_tbl_start, 8);
+    sqfs_put(v, frag_tbl_start, 8);
+    sqfs_put(v, UINT64_MAX, 8);         // no export (NFS) table
+    if ((fseeko(fp, 0, SEEK_SET) < 0) ||
+        (fwrite(v.data(), 1, v.size(), fp) != v.size()))
+        ec.assign(errno ? errno : EIO, std::system_category());
+    if ((fclose(fp) != 0) && (! ec))
+        ec.assign(errno, std::system_category());
+    q->num_sqfs_inode += num_ino;
+    return ec;
+}
+
+// Called from main(). Starts pass 1 (caching) when --cache or --prune=
+// option is given. Also invokes pass 2 if op->prune_given and then invokes
+// the unroll (in-memory tree rolled out into the destination) which is the
+// final pass.
+static std::error_code
+do_cache(const inmem_t & src_rt_cache, const struct opts_t * op) noexcept
+{
+    int pass { 1 };
+    std::error_code ec { };
+    uint8_t * sbrk_p { static_cast<uint8_t *>(sbrk(0)) };
+    struct mut_opts_t * omutp { op->mutp };
+    struct stats_t * q { &omutp->stats };
+    std::ostream & tout { omutp->tm_osp ? *omutp->tm_osp : scout };
+    auto ch_start { chron::steady_clock::now() };
+
+    q->num_node = 1;    // count the source root node
+    pr_err(5, "\n{}: >> start of pass {} (cache source)\n", __func__, pass);
+    ec = cache_src_par(op);
     if (ec)
         pr_err(-1, "{}: problem with cache_src({}){}\n", __func__,
                s(op->source_pt), l(ec));
@@ -3222,7 +5895,22 @@ do_cache(const inmem_t & src_rt_cache, const struct opts_t * op) noexcept
     char b[32];
     snprintf(b, sizeof(b), "%d.%03d", static_cast<int>(secs),
              static_cast<int>(ms_remainder));
-    scout << "Caching time: " << b << " seconds\n";
+    tout << "Caching time: " << b << " seconds\n";
+
+    if (op->sort_sdirs) {
+        auto start_of_sort { ch_end };
+
+        ++pass;
+        pr_err(5, "\n{}: >> start of pass {} (sort)\n", __func__, pass);
+        sort_cache(omutp->cache_rt_dirp, op);
+        ch_end = chron::steady_clock::now();
+        ms = chron::duration_cast<chron::milliseconds>
+                                        (ch_end - start_of_sort).count();
+        total_ms += ms;
+        snprintf(b, sizeof(b), "%d.%03d", static_cast<int>(ms / 1000),
+                 static_cast<int>(ms % 1000));
+        tout << "Sorting time: " << b << " seconds\n";
+    }
 
     bool skip_destin = op->no_destin;
 
@@ -3243,7 +5931,7 @@ do_cache(const inmem_t & src_rt_cache, const struct opts_t * op) noexcept
             ms_remainder = ms % 1000;
             snprintf(b, sizeof(b), "%d.%03d", static_cast<int>(secs),
                      static_cast<int>(ms_remainder));
-            scout << "Prune propagate time: " << b << " seconds\n";
+            tout << "Prune propagate time: " << b << " seconds\n";
         } else {
             pr_err(-1, "prune requested but no nodes found so no output\n");
             skip_destin = true;
@@ -3254,11 +5942,49 @@ do_cache(const inmem_t & src_rt_cache, const struct opts_t * op) noexcept
     auto start_of_unroll { ch_end };
     bool do_unroll { false };
     if (! skip_destin) {
+        path_bld_t s_bld(op->source_pt.native());
+        path_bld_t d_bld(op->destination_pt.native());
+
         do_unroll = true;
-        ec = unroll_cache(src_rt_cache, op->source_pt.parent_path(),
-                          true, op);
+        ec = unroll_cache(src_rt_cache, s_bld, d_bld, true, op);
         if (ec)
             pr_err(0, "unroll_cache() failed{}\n", l(ec));
+        if (op->preserve) {
+            pr_err(5, "\n{}: >> start of pass {} (preserve metadata)\n",
+                   __func__, ++pass);
+            meta_apply(op);
+        }
+    }
+
+    if (op->col_dn) {
+        auto start_of_col { chron::steady_clock::now() };
+        path_bld_t c_bld(op->col_dn);
+
+        col_export(omutp->cache_rt_dirp, c_bld, op);
+        ms = chron::duration_cast<chron::milliseconds>
+                        (chron::steady_clock::now() - start_of_col).count();
+        snprintf(b, sizeof(b), "%d.%03d", static_cast<int>(ms / 1000),
+                 static_cast<int>(ms % 1000));
+        tout << "Columnar export time: " << b << " seconds\n";
+    }
+
+    if (op->sqfs_fn && (! (op->prune_given && (q->num_prune_exact == 0)))) {
+        auto start_of_sqfs { chron::steady_clock::now() };
+
+        pr_err(5, "\n{}: >> start of pass {} (SquashFS image)\n", __func__,
+               ++pass);
+        std::error_code sq_ec { sqfs_export(omutp->cache_rt_dirp,
+                                            op->sqfs_fn, op) };
+        if (sq_ec) {
+            pr_err(-1, "unable to write --squashfs={}{}\n", op->sqfs_fn,
+                   l(sq_ec));
+            ec = sq_ec;
+        }
+        ms = chron::duration_cast<chron::milliseconds>
+                        (chron::steady_clock::now() - start_of_sqfs).count();
+        snprintf(b, sizeof(b), "%d.%03d", static_cast<int>(ms / 1000),
+                 static_cast<int>(ms % 1000));
+        tout << "SquashFS image time: " << b << " seconds\n";
     }
 
     if (op->do_extra) {
@@ -3290,34 +6016,1074 @@ do_cache(const inmem_t & src_rt_cache, const struct opts_t * op) noexcept
     if (do_unroll) {
         snprintf(b, sizeof(b), "%d.%03d", static_cast<int>(secs),
                  static_cast<int>(ms_remainder));
-        scout << "Cache unrolling time: " << b << " seconds\n";
+        tout << "Cache unrolling time: " << b << " seconds\n";
+    }
+    secs = total_ms / 1000;
+    ms_remainder = total_ms % 1000;
+    snprintf(b, sizeof(b), "%d.%03d", static_cast<int>(secs),
+             static_cast<int>(ms_remainder));
+    tout << "Total processing time: " << b << " seconds\n";
+
+    if ((op->want_stats > 0) && (! omutp->tm_osp))
+        show_stats(op);
+    return ec;
+}
+
+// Reads up to bp_sz bytes of fn, relative to directory fd s_dfd, into bp.
+// Returns the number of bytes read (0 or more) else -errno .
+static int
+procfs_read_at(int s_dfd, const char * fn, uint8_t * bp, int bp_sz) noexcept
+{
+    int fd { openat(s_dfd, fn, O_RDONLY | O_CLOEXEC) };
+    int off { };
+
+    if (fd < 0)
+        return -errno;
+    while (off < bp_sz) {
+        int num { static_cast<int>(read(fd, bp + off, bp_sz - off)) };
+
+        if (num < 0) {
+            if (errno == EINTR)
+                continue;
+            off = -errno;
+            break;
+        }
+        if (num == 0)
+            break;
+        off += num;
+    }
+    close(fd);
+    return off;
+}
+
+// Creates directory fn in d_dfd (no problem if it exists) and returns a
+// directory fd for it, or -1 .
+static int
+procfs_mkdir_at(int d_dfd, const char * fn, struct stats_t * q) noexcept
+{
+    if (mkdirat(d_dfd, fn, 0777) == 0)
+        ++q->num_dir_d_success;
+    else if (errno == EEXIST)
+        ++q->num_dir_d_exists;
+    else {
+        ++q->num_dir_d_fail;
+        return -1;
+    }
+    return openat(d_dfd, fn, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+// Writes num bytes from bp to file fn (created or truncated) in directory
+// fd d_dfd, updating the regular file destination statistics.
+static void
+procfs_write_at(int d_dfd, const char * fn, const uint8_t * bp, int num,
+                struct stats_t * q) noexcept
+{
+    int fd { openat(d_dfd, fn, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    def_file_perm) };
+
+    if (fd < 0) {
+        reg_d_err_stats(errno, q);
+        return;
+    }
+    if ((num > 0) && (write(fd, bp, num) < 0))
+        reg_d_err_stats(errno, q);
+    else
+        ++q->num_reg_success;
+    close(fd);
+}
+
+// Appends the names of the all digit entries of dp (i.e. PIDs or TIDs) to
+// id_v .
+static void
+procfs_list_ids(DIR * dp, std::vector<sstring> & id_v) noexcept
+{
+    for (const struct dirent * dep { readdir(dp) }; dep;
+         dep = readdir(dp)) {
+        const char * cp { dep->d_name };
+
+        if ((*cp < '1') || (*cp > '9'))
+            continue;
+        for (++cp; (*cp >= '0') && (*cp <= '9'); ++cp)
+            ;
+        if (*cp == '\0')
+            id_v.emplace_back(dep->d_name);
+    }
+}
+
+// Takes the FSET files from s_dfd (a /proc/PID or /proc/PID/task/TID
+// directory) and, unless d_dfd is -1 (e.g. --no-dst), writes them into
+// d_dfd. Returns false if that process has gone.
+static bool
+procfs_harvest_dir(int s_dfd, int d_dfd, uint8_t * bp,
+                   const struct opts_t * op, struct stats_t * q) noexcept
+{
+    const int bp_sz { static_cast<int>(op->reglen) };
+
+    for (const auto & fn : op->procfs_fset_v) {
+        int num { procfs_read_at(s_dfd, fn.c_str(), bp, bp_sz) };
+
+        if (num < 0) {
+            // files needing an mm (e.g. smaps_rollup) yield ESRCH for a
+            // kernel thread, so check the process itself has gone
+            if (((num == -ESRCH) || (num == -ENOENT)) &&
+                (faccessat(s_dfd, "stat", F_OK, 0) < 0))
+                return false;
+            pr_err(4, "{}: {} unreadable{}\n", __func__, fn,
+                   l(std::error_code(-num, std::system_category())));
+            ++q->num_proc_file_err;
+            continue;
+        }
+        ++q->num_proc_file;
+        if (num >= bp_sz)
+            ++q->num_reg_s_at_reglen;
+        if (d_dfd >= 0)
+            procfs_write_at(d_dfd, fn.c_str(), bp, num, q);
+    }
+    return true;
+}
+
+// Harvests one process: the FSET files of /proc/PID and, with
+// --procfs=...,task , of each /proc/PID/task/TID as well. Otherwise the
+// threads of a process are folded into it (i.e. not listed).
+static void
+procfs_harvest_pid(int s_rt_fd, int d_rt_fd, const sstring & pid_s,
+                   uint8_t * bp, const struct opts_t * op,
+                   struct stats_t * q) noexcept
+{
+    const int dir_flags { O_RDONLY | O_DIRECTORY | O_CLOEXEC };
+    int s_dfd { openat(s_rt_fd, pid_s.c_str(), dir_flags) };
+    int d_dfd { -1 };
+    DIR * t_dp { };
+
+    if (s_dfd < 0) {    // exited since it was listed
+        ++q->num_proc_gone;
+        return;
+    }
+    if (d_rt_fd >= 0)
+        d_dfd = procfs_mkdir_at(d_rt_fd, pid_s.c_str(), q);
+    if (! procfs_harvest_dir(s_dfd, d_dfd, bp, op, q)) {
+        ++q->num_proc_gone;
+        goto fini;
+    }
+    ++q->num_proc_pid;
+    if (op->procfs_task) {
+        int t_dfd { openat(s_dfd, "task", dir_flags) };
+        int d_t_dfd { -1 };
+        std::vector<sstring> tid_v;
+
+        if ((t_dfd < 0) || ((t_dp = fdopendir(t_dfd)) == nullptr)) {
+            if (t_dfd >= 0)
+                close(t_dfd);
+            goto fini;
+        }
+        procfs_list_ids(t_dp, tid_v);
+        if (d_dfd >= 0)
+            d_t_dfd = procfs_mkdir_at(d_dfd, "task", q);
+        for (const auto & tid_s : tid_v) {
+            int s_tdfd { openat(dirfd(t_dp), tid_s.c_str(), dir_flags) };
+            int d_tdfd { -1 };
+
+            if (s_tdfd < 0)
+                continue;       // that thread has exited
+            if (d_t_dfd >= 0)
+                d_tdfd = procfs_mkdir_at(d_t_dfd, tid_s.c_str(), q);
+            if (procfs_harvest_dir(s_tdfd, d_tdfd, bp, op, q))
+                ++q->num_proc_tid;
+            if (d_tdfd >= 0)
+                close(d_tdfd);
+            close(s_tdfd);
+        }
+        if (d_t_dfd >= 0)
+            close(d_t_dfd);
+    }
+fini:
+    if (t_dp)
+        closedir(t_dp);
+    if (d_dfd >= 0)
+        close(d_dfd);
+    close(s_dfd);
+}
+
+// Called from main() when --procfs[=FSET] is given, in place of a clone.
+// Lists the PIDs in SPATH once, then harvests each process on up to NJ
+// (--jobs=NJ, def: one per CPU) threads. Every file of a process is opened
+// relative to that process's directory fd, so its path is not walked again
+// for each file.
+static std::error_code
+do_procfs(const struct opts_t * op) noexcept
+{
+    const int dir_flags { O_RDONLY | O_DIRECTORY | O_CLOEXEC };
+    unsigned int num_thr { op->jobs_given ? op->jobs
+                           : std::max(std::thread::hardware_concurrency(),
+                                      1U) };
+    int s_rt_fd { -1 };
+    int d_rt_fd { -1 };
+    std::error_code ec { };
+    struct stats_t * q { &op->mutp->stats };
+    std::vector<sstring> pid_v;
+    auto start { chron::steady_clock::now() };
+    DIR * dp { opendir(op->source_pt.c_str()) };
+
+    if (dp == nullptr) {
+        ec.assign(errno, std::system_category());
+        pr_err(-1, "opendir({}) failed{}\n", s(op->source_pt), l(ec));
+        return ec;
+    }
+    procfs_list_ids(dp, pid_v);
+    closedir(dp);
+    if (pid_v.empty()) {
+        ec.assign(ENOENT, std::system_category());
+        pr_err(-1, "no PID directories in {}, is it procfs?{}\n",
+               s(op->source_pt), l());
+        return ec;
+    }
+    s_rt_fd = open(op->source_pt.c_str(), dir_flags);
+    if ((s_rt_fd >= 0) && (! op->no_destin))
+        d_rt_fd = open(op->destination_pt.c_str(), dir_flags);
+    if ((s_rt_fd < 0) || ((! op->no_destin) && (d_rt_fd < 0))) {
+        ec.assign(errno, std::system_category());
+        pr_err(-1, "{}: unable to open SPATH or DPATH{}\n", __func__, l(ec));
+        if (s_rt_fd >= 0)
+            close(s_rt_fd);
+        return ec;
+    }
+    num_thr = std::min(static_cast<size_t>(num_thr), pid_v.size());
+    std::vector<uint8_t> buf_v(static_cast<size_t>(num_thr) * op->reglen);
+    std::vector<struct stats_t> wstats_v(num_thr);
+
+    pr_err(2, "{}: {} PIDs to {} threads{}\n", __func__, pid_v.size(),
+           num_thr, l());
+    run_workers(num_thr, pid_v.size(), [&](size_t k, unsigned int t) {
+        procfs_harvest_pid(s_rt_fd, d_rt_fd, pid_v[k],
+                           buf_v.data() + (size_t)t * op->reglen, op,
+                           &wstats_v[t]);
+    });
+    for (const auto & wstats : wstats_v)
+        stats_merge(*q, wstats);
+    if (d_rt_fd >= 0)
+        close(d_rt_fd);
+    close(s_rt_fd);
+
+    auto ms { chron::duration_cast<chron::milliseconds>
+                        (chron::steady_clock::now() - start).count() };
+    char b[32];
+    snprintf(b, sizeof(b), "%d.%03d", static_cast<int>(ms / 1000),
+             static_cast<int>(ms % 1000));
+    scout << "Procfs harvest time: " << b << " seconds\n";
+    if (op->want_stats > 0)
+        show_stats(op);
+    return ec;
+}
+
+// (column name, value) pairs of one cgroup for --table=TFILE
+using cgrp_cols_t = std::vector<std::pair<sstring, sstring>>;
+
+// Adds each directory (i.e. cgroup) below s_dfd, whose path relative to
+// SPATH is rel_s, to rel_v, depth first. Unless d_dfd is -1, the
+// corresponding directories are made under DPATH as they are found so they
+// all exist before the harvest starts. Uses an explicit stack of the open
+// directories, one per level. Closes s_dfd and d_dfd .
+static void
+cgroup_list_dirs(int s_dfd, int d_dfd, const sstring & rel_s,
+                 std::vector<sstring> & rel_v, struct stats_t * q) noexcept
+{
+    struct cgrp_frm_t {
+        DIR * dp;
+        int d_dfd;              // -1 when no DPATH
+        sstring rel_s;
+    };
+    const int dir_flags { O_RDONLY | O_DIRECTORY | O_CLOEXEC };
+    std::vector<cgrp_frm_t> stk;
+    sstring c_rel_s { rel_s };
+
+    for ( ; ; ) {
+        // s_dfd, d_dfd and c_rel_s are the next directory, if s_dfd >= 0
+        if (s_dfd >= 0) {
+            DIR * dp { fdopendir(s_dfd) };
+
+            if (dp == nullptr) {
+                close(s_dfd);
+                if (d_dfd >= 0)
+                    close(d_dfd);
+            } else
+                stk.push_back({dp, d_dfd, std::move(c_rel_s)});
+            s_dfd = -1;
+        }
+        if (stk.empty())
+            break;
+        cgrp_frm_t & frm { stk.back() };
+        const struct dirent * dep { readdir(frm.dp) };
+
+        if (dep == nullptr) {
+            closedir(frm.dp);
+            if (frm.d_dfd >= 0)
+                close(frm.d_dfd);
+            stk.pop_back();
+            continue;
+        }
+        const char * cp { dep->d_name };
+        struct stat a_stat;
+
+        if ((0 == strcmp(cp, ".")) || (0 == strcmp(cp, "..")))
+            continue;
+        if (dep->d_type == DT_UNKNOWN) {
+            if ((fstatat(dirfd(frm.dp), cp, &a_stat,
+                         AT_SYMLINK_NOFOLLOW) < 0) ||
+                (! S_ISDIR(a_stat.st_mode)))
+                continue;
+        } else if (dep->d_type != DT_DIR)
+            continue;
+        s_dfd = openat(dirfd(frm.dp), cp, dir_flags);
+        if (s_dfd < 0)
+            continue;           // removed since listed
+        c_rel_s = frm.rel_s + "/" + cp;
+        rel_v.push_back(c_rel_s);
+        d_dfd = (frm.d_dfd >= 0) ? procfs_mkdir_at(frm.d_dfd, cp, q) : -1;
+        // opened and pushed at the top of the next iteration
+    }
+}
+
+// Splits the contents of cgroup file fn into (column name, value) pairs.
+// Contents of one line without '=' (e.g. memory.current or cpu.max) give
+// the column fn. Otherwise each 'KEY VALUE' line (e.g. cpu.stat) gives the
+// column fn.KEY and each 'KEY K1=V1 K2=V2 ..' line (e.g. io.stat or
+// cpu.pressure) gives the columns fn.KEY.K1 and so on. Lines holding one
+// token (e.g. cgroup.procs) are joined, space separated, as column fn.
+static void
+cgroup_to_cols(const sstring & fn, std::string_view sv,
+               cgrp_cols_t & col_v) noexcept
+{
+    sstring lone_s;
+
+    while ((! sv.empty()) && (sv.back() == '\n'))
+        sv.remove_suffix(1);
+    if ((sv.find('\n') == sv.npos) && (sv.find('=') == sv.npos)) {
+        col_v.emplace_back(fn, sv);
+        return;
+    }
+    for (const auto & ln_r : std::views::split(sv, '\n')) {
+        const std::string_view ln(ln_r.begin(), ln_r.end());
+        const auto sp { ln.find(' ') };
+
+        if (ln.empty())
+            continue;
+        if (sp == ln.npos) {
+            if (! lone_s.empty())
+                lone_s += ' ';
+            lone_s += ln;
+            continue;
+        }
+        const sstring key_s { fn + "." + sstring(ln.substr(0, sp)) };
+        const std::string_view rest { ln.substr(sp + 1) };
+
+        if (rest.find('=') == rest.npos) {
+            col_v.emplace_back(key_s, rest);
+            continue;
+        }
+        for (const auto & kv_r : std::views::split(rest, ' ')) {
+            const std::string_view kv(kv_r.begin(), kv_r.end());
+            const auto eq { kv.find('=') };
+
+            if (eq != kv.npos)
+                col_v.emplace_back(key_s + "." + sstring(kv.substr(0, eq)),
+                                   kv.substr(eq + 1));
+        }
+    }
+    if (! lone_s.empty())
+        col_v.emplace_back(fn, std::move(lone_s));
+}
+
+// Harvests the FSET files of one cgroup, rel_s relative to SPATH (s_rt_fd)
+// into the same place under DPATH (unless d_rt_fd is -1) and, if colp is
+// given, into its columns for --table=TFILE .
+static void
+cgroup_harvest(int s_rt_fd, int d_rt_fd, const sstring & rel_s,
+               uint8_t * bp, cgrp_cols_t * colp, const struct opts_t * op,
+               struct stats_t * q) noexcept
+{
+    const int dir_flags { O_RDONLY | O_DIRECTORY | O_CLOEXEC };
+    const int bp_sz { static_cast<int>(op->reglen) };
+    const char * rel_nm { rel_s.empty() ? "." : (rel_s.c_str() + 1) };
+    int s_dfd { openat(s_rt_fd, rel_nm, dir_flags) };
+    int d_dfd { -1 };
+
+    if (s_dfd < 0) {    // removed since it was listed
+        ++q->num_cgrp_gone;
+        return;
+    }
+    if (d_rt_fd >= 0)
+        d_dfd = openat(d_rt_fd, rel_nm, dir_flags);
+    ++q->num_cgrp_dir;
+    for (const auto & fn : op->cgroup_fset_v) {
+        int num { procfs_read_at(s_dfd, fn.c_str(), bp, bp_sz) };
+
+        if (num < 0) {
+            // ENOENT: that controller is not enabled in this cgroup
+            if (num != -ENOENT) {
+                pr_err(4, "{}: {}/{} unreadable{}\n", __func__, rel_s, fn,
+                       l(std::error_code(-num, std::system_category())));
+                ++q->num_cgrp_file_err;
+            }
+            continue;
+        }
+        ++q->num_cgrp_file;
+        if (num >= bp_sz)
+            ++q->num_reg_s_at_reglen;
+        if (colp)
+            cgroup_to_cols(fn, std::string_view(
+                                reinterpret_cast<const char *>(bp), num),
+                           *colp);
+        if (d_dfd >= 0)
+            procfs_write_at(d_dfd, fn.c_str(), bp, num, q);
+    }
+    if (colp)
+        std::ranges::sort(*colp);
+    if (d_dfd >= 0)
+        close(d_dfd);
+    close(s_dfd);
+}
+
+// Writes TFILE as CSV: a header line of 'cgroup' followed by the union of
+// all column names, then a line per cgroup (its path relative to SPATH)
+// with an empty field for each column that cgroup lacks. Returns 0 or an
+// errno value.
+static int
+cgroup_write_table(const char * tfn, const std::vector<sstring> & rel_v,
+                   const std::vector<cgrp_cols_t> & col_vv) noexcept
+{
+    std::vector<sstring> nm_v;
+    std::ofstream ofs(tfn, std::ios::trunc);
+
+    if (! ofs)
+        return errno ? errno : EIO;
+    for (const auto & col_v : col_vv) {
+        for (const auto & [nm, val] : col_v)
+            nm_v.push_back(nm);
+    }
+    std::ranges::sort(nm_v);
+    nm_v.erase(std::unique(nm_v.begin(), nm_v.end()), nm_v.end());
+    ofs << "cgroup";
+    for (const auto & nm : nm_v) {
+        ofs << ',';
+        csv_field(ofs, nm);
+    }
+    ofs << '\n';
+    for (size_t k { }; k < rel_v.size(); ++k) {
+        const cgrp_cols_t & col_v { col_vv[k] };
+        size_t j { };
+
+        csv_field(ofs, rel_v[k].empty() ? "/" : rel_v[k]);
+        // both sorted by name, so a merge
+        for (const auto & nm : nm_v) {
+            ofs << ',';
+            if ((j < col_v.size()) && (col_v[j].first == nm)) {
+                csv_field(ofs, col_v[j].second);
+                while ((j < col_v.size()) && (col_v[j].first == nm))
+                    ++j;        // a repeated name keeps its first value
+            }
+        }
+        ofs << '\n';
+    }
+    ofs.close();
+    return ofs ? 0 : EIO;
+}
+
+// Called from main() when --cgroup[=FSET] is given, in place of a clone.
+// Lists the cgroups (directories) in SPATH once, then harvests the FSET
+// files of each cgroup on up to NJ (--jobs=NJ, def: one per CPU) threads.
+// With --table=TFILE the files are also split into columns and written as
+// one CSV row per cgroup.
+static std::error_code
+do_cgroup(const struct opts_t * op) noexcept
+{
+    const int dir_flags { O_RDONLY | O_DIRECTORY | O_CLOEXEC };
+    unsigned int num_thr { op->jobs_given ? op->jobs
+                           : std::max(std::thread::hardware_concurrency(),
+                                      1U) };
+    int s_rt_fd { open(op->source_pt.c_str(), dir_flags) };
+    int d_rt_fd { -1 };
+    std::error_code ec { };
+    struct stats_t * q { &op->mutp->stats };
+    std::vector<sstring> rel_v { sstring() };   // SPATH is the root cgroup
+    auto start { chron::steady_clock::now() };
+
+    if ((s_rt_fd >= 0) && (! op->no_destin))
+        d_rt_fd = open(op->destination_pt.c_str(), dir_flags);
+    if ((s_rt_fd < 0) || ((! op->no_destin) && (d_rt_fd < 0))) {
+        ec.assign(errno, std::system_category());
+        pr_err(-1, "{}: unable to open SPATH or DPATH{}\n", __func__, l(ec));
+        if (s_rt_fd >= 0)
+            close(s_rt_fd);
+        return ec;
+    }
+    cgroup_list_dirs(dup(s_rt_fd), (d_rt_fd >= 0) ? dup(d_rt_fd) : -1,
+                     sstring(), rel_v, q);
+    num_thr = std::max(std::min(static_cast<size_t>(num_thr), rel_v.size()),
+                       static_cast<size_t>(1));
+    std::vector<uint8_t> buf_v(static_cast<size_t>(num_thr) * op->reglen);
+    std::vector<struct stats_t> wstats_v(num_thr);
+    std::vector<cgrp_cols_t> col_vv(op->table_fn ? rel_v.size() : 0);
+
+    pr_err(2, "{}: {} cgroups to {} threads{}\n", __func__, rel_v.size(),
+           num_thr, l());
+    run_workers(num_thr, rel_v.size(), [&](size_t k, unsigned int t) {
+        cgroup_harvest(s_rt_fd, d_rt_fd, rel_v[k],
+                       buf_v.data() + (size_t)t * op->reglen,
+                       op->table_fn ? &col_vv[k] : nullptr, op,
+                       &wstats_v[t]);
+    });
+    for (const auto & wstats : wstats_v)
+        stats_merge(*q, wstats);
+    if (d_rt_fd >= 0)
+        close(d_rt_fd);
+    close(s_rt_fd);
+    if (op->table_fn) {
+        int res { cgroup_write_table(op->table_fn, rel_v, col_vv) };
+
+        if (res) {
+            ec.assign(res, std::system_category());
+            pr_err(-1, "unable to write --table={}{}\n", op->table_fn,
+                   l(ec));
+        }
+    }
+
+    auto ms { chron::duration_cast<chron::milliseconds>
+                        (chron::steady_clock::now() - start).count() };
+    char b[32];
+    snprintf(b, sizeof(b), "%d.%03d", static_cast<int>(ms / 1000),
+             static_cast<int>(ms % 1000));
+    scout << "Cgroup harvest time: " << b << " seconds\n";
+    if (op->want_stats > 0)
+        show_stats(op);
+    return ec;
+}
+
+// Clones op->source_pt to op->destination_pt, via the in-memory tree
+// when --cache is given, else in a single pass.
+static std::error_code
+do_clone_src(const struct opts_t * op) noexcept
+{
+    std::error_code ec { };
+
+    if (op->cache_op_num > 0) {
+        inmem_dir_t s_inm_rt(op->source_pt.filename(), short_stat());
+        struct stat root_stat;
+
+        s_inm_rt.is_root = 1;
+        fs::path s_p_pt { op->source_pt.parent_path() };
+        if (0 == s_p_pt.compare(op->source_pt.root_path())) {
+            s_inm_rt.par_pt_s.clear();
+        } else {
+            s_inm_rt.par_pt_s = s_p_pt;
+        }
+
+        s_inm_rt.depth = -1;
+        if (stat(op->source_pt.c_str(), &root_stat) < 0) {
+            ec.assign(errno, std::system_category());
+            pr_err(-1, "stat(source) failed{}\n", l(ec));
+            return ec;
+        }
+        op->mutp->starting_fs_inst = root_stat.st_dev;
+
+        // auto * rt_dirp { &s_inm_rt };
+        s_inm_rt.shstat.st_dev = root_stat.st_dev;
+        s_inm_rt.shstat.st_mode = root_stat.st_mode;
+        if (op->prune_given)
+            s_inm_rt.prune_mask = prune_up_chain;
+        auto rt_up { std::make_unique<inmem_t>(s_inm_rt) };
+        inmem_t & src_rt_cache { *rt_up };
+        op->mutp->cache_rt_dirp = std::get_if<inmem_dir_t>(&src_rt_cache);
+
+        if (cpf_verbose > 4) {
+            pr_err(4, ">>> initial, empty cache tree:");
+            show_cache(src_rt_cache, true, op);
+        }
+        ec = do_cache(src_rt_cache, op);  // src ==> cache ==> destination
+        if (cpf_verbose > 4) {
+            pr_err(4, ">>> final cache tree:\n");
+            show_cache(src_rt_cache, true, op);
+        }
+        // Destroying a large tree node by node takes a noticeable time. A
+        // lone clone is the last thing done, so leave the tree for the
+        // process exit to reclaim in bulk. Each clone of do_multi_src()
+        // must free its tree so the next does not add to peak memory.
+        if (op->mutp->tm_osp == nullptr)
+            exit_cache_rtp = rt_up.release();
+    } else {
+        ec = do_clone(op);      // Single pass
+        if (ec)
+            pr_err(-1, "do_clone() failed{}\n", l());
+    }
+    return ec;
+}
+
+// Does each clone in ms_v, as do_clone_src() would for a single SPATH
+// and DPATH. The clones are shared out to up to NJ (--jobs=NJ, def: def_thr)
+// threads, each clone with its own copy of the options. NJ (def: one per
+// CPU) also bounds the threads used within each clone (e.g. pass 1 of
+// --cache) so that together they do not exceed it. Read buffers are per
+// thread, reused by each clone on it. Each clone has its own contents
+// arena, freed along with its cache tree when the clone is done. When
+// per_prof is true each SPATH gets the defaults of its own file system's
+// profile (see apply_src_profile()). Each clone's times are shown once all
+// are done, in ms_v order, then the merged statistics.
+static std::error_code
+do_multi_src(const std::vector<multi_src_t> & ms_v, unsigned int def_thr,
+             bool per_prof, const struct opts_t * op) noexcept
+{
+    struct mut_opts_t * omutp { op->mutp };
+    const size_t num_ms { ms_v.size() };
+    const unsigned int num_cpu { std::max(std::thread::hardware_concurrency(),
+                                          1U) };
+    const unsigned int num_thr { std::max(op->jobs_given ? op->jobs : def_thr,
+                                          1U) };
+    const unsigned int num_busy
+                { static_cast<unsigned int>(std::min<size_t>(num_thr,
+                                                             num_ms)) };
+    // threads each clone may use when num_busy clones are running
+    const unsigned int per_ms_thr
+                { std::max((op->jobs_given ? op->jobs : num_cpu) /
+                           std::max(num_busy, 1U), 1U) };
+    std::vector<struct mut_opts_t> wmut_v(num_ms, *omutp);
+    std::vector<struct opts_t> wopt_v(num_ms, *op);
+    std::vector<std::ostringstream> tm_v(num_ms);
+    std::vector<sstring> col_v(num_ms);
+    std::vector<sstring> sqfs_v(num_ms);
+    std::vector<std::error_code> ec_v(num_ms);
+    std::vector<std::shared_ptr<uint8_t[]>> buff_v(num_thr);
+    std::vector<unsigned int> buff_sz_v(num_thr);
+    std::error_code ec { };
+
+    run_workers(num_thr, num_ms, [&](size_t k, unsigned int t) {
+        const multi_src_t & ms { ms_v[k] };
+        struct opts_t * wop { &wopt_v[k] };
+        struct mut_opts_t * wmutp { &wmut_v[k] };
+        std::error_code & wec { ec_v[k] };
+        struct stat root_stat;
+        contents_arena_t arena;     // freed when this clone is done
+
+        wop->mutp = wmutp;
+        wmutp->arenap = &arena;
+        wmutp->tm_osp = &tm_v[k];
+        wop->source_pt = ms.source_pt;
+        wmutp->starting_src_sz = (ms.source_pt == "/") ? 0 :
+                                 ms.source_pt.native().size();
+        if (stat(wop->source_pt.c_str(), &root_stat) < 0) {
+            wec.assign(errno, std::system_category());
+            return;
+        }
+        if (! S_ISDIR(root_stat.st_mode)) {
+            wec.assign(ENOTDIR, std::system_category());
+            return;
+        }
+        if (per_prof) {
+            if (apply_src_profile(wop)) {
+                wec.assign(EINVAL, std::system_category());
+                return;
+            }
+            select_scan_pol(wop);
+        }
+        wop->jobs = std::min(wop->jobs, per_ms_thr);
+        wop->jobs_given = true;
+        if (wop->reglen > def_reglen) {
+            if (buff_sz_v[t] < wop->reglen) {
+                buff_v[t] = std::make_shared<uint8_t []>(
+                                        (size_t)wop->reglen, 0);
+                buff_sz_v[t] = buff_v[t] ? wop->reglen : 0;
+            }
+            wop->reg_buff_sp = buff_v[t];
+            if (! wop->reg_buff_sp) {
+                wec.assign(ENOMEM, std::system_category());
+                return;
+            }
+        }
+        if (! op->rollover_pt.empty())      // --ns-pid: PREV/PID
+            wop->rollover_pt = op->rollover_pt / ms.tag;
+        if (op->col_dn) {
+            col_v[k] = (fs::path(op->col_dn) / ms.tag).native();
+            wop->col_dn = col_v[k].c_str();
+        }
+        if (op->sqfs_fn) {
+            sqfs_v[k] = sstring(op->sqfs_fn) + "." + ms.tag;
+            wop->sqfs_fn = sqfs_v[k].c_str();
+        }
+        if (! op->no_destin) {
+            wop->destination_pt = ms.destination_pt;
+            if (mkdir(wop->destination_pt.c_str(), 0755) == 0)
+                wop->destin_all_new = true;
+            else if (errno == EEXIST)
+                wop->destin_all_new = false;
+            else {
+                wec.assign(errno, std::system_category());
+                return;
+            }
+            if (op->dev_mf_given) {
+                const sstring mf_s { op->dev_mf_fn ?
+                            sstring(op->dev_mf_fn) + "." + ms.tag :
+                            (wop->destination_pt / def_dev_mf_fn).native() };
+
+                wmutp->dev_mf_fp = dev_manifest_open(mf_s, wop);
+                if (wmutp->dev_mf_fp == nullptr) {
+                    wec.assign(errno, std::system_category());
+                    return;
+                }
+            }
+        }
+        wec = do_clone_src(wop);
+        if (wmutp->dev_mf_fp && (fclose(wmutp->dev_mf_fp) != 0) && (! wec))
+            wec.assign(errno, std::system_category());
+        // its entries point into the arena
+        std::unordered_map<uint64_t, dedup_ent_t>().swap(wmutp->dedup_m);
+        wmutp->arenap = nullptr;
+    });
+    for (size_t k { }; k < num_ms; ++k) {
+        stats_merge(omutp->stats, wmut_v[k].stats);
+        scout << ms_v[k].label << ":\n" << tm_v[k].str();
+        if (ec_v[k]) {
+            pr_err(-1, "{}: unable to clone {}{}\n", ms_v[k].label,
+                   s(ms_v[k].source_pt), l(ec_v[k]));
+            ec = ec_v[k];
+        }
+    }
+    if (op->want_stats > 0)
+        show_stats(op);
+    return ec;
+}
+
+// Called from main() when --ns-pid=PID,... is given. SPATH as each PID
+// sees it is reached through its /proc/PID/root link, so in that process's
+// mount namespace (e.g. a container's /sys), and is cloned to DPATH/PID .
+static std::error_code
+do_ns_pid(const struct opts_t * op) noexcept
+{
+    const sstring & src_s { op->source_pt.native() };
+    std::vector<multi_src_t> ms_v;
+
+    for (const pid_t pid : op->ns_pid_v) {
+        const sstring pid_s { std::to_string(pid) };
+
+        // SPATH is absolute so this is /proc/PID/root/<SPATH>
+        ms_v.push_back({pid_s, "PID " + pid_s,
+                        procfs_root + "/" + pid_s + "/root" +
+                        ((src_s == "/") ? sstring() : src_s),
+                        op->destination_pt / pid_s});
+    }
+    return do_multi_src(ms_v, ms_v.size(), false, op);
+}
+
+// Reads --batch=BFILE into ms_v, one clone per line: SPATH then DPATH,
+// separated by whitespace; DPATH is left out when --no-dst is given.
+// Blank lines and those starting with '#' are ignored. Relative paths are
+// taken from the current directory. Returns 0 on success else 1 .
+static int
+batch_load(const struct opts_t * op, std::vector<multi_src_t> & ms_v) noexcept
+{
+    std::error_code ec { };
+    std::ifstream ifs(op->batch_fn);
+    sstring line;
+    auto abs_norm = [&ec](const sstring & str) -> fs::path {
+        fs::path pt { fs::absolute(str, ec).lexically_normal() };
+
+        if ((! ec) && pt.filename().empty() && pt.has_relative_path())
+            pt = pt.parent_path();  // drop trailing '/'
+        return pt;
+    };
+
+    if (! ifs) {
+        ec.assign(errno, std::system_category());
+        pr_err(-1, "unable to open --batch={}{}\n", op->batch_fn, l(ec));
+        return 1;
+    }
+    for (int ln { 1 }; std::getline(ifs, line); ++ln) {
+        std::istringstream iss(line);
+        sstring s_str, d_str, extra;
+
+        if ((! (iss >> s_str)) || (s_str[0] == '#'))
+            continue;
+        iss >> d_str;
+        if ((iss >> extra) || (d_str.empty() != op->no_destin)) {
+            pr_err(-1, "--batch={} line {}: expected SPATH{}{}\n",
+                   op->batch_fn, ln, op->no_destin ? " only" : " then DPATH",
+                   l());
+            return 1;
+        }
+        multi_src_t ms { std::to_string(ln), sstring(), abs_norm(s_str), { } };
+
+        if ((! ec) && (! op->no_destin))
+            ms.destination_pt = abs_norm(d_str);
+        if (ec) {
+            pr_err(-1, "--batch={} line {}: fs::absolute() failed{}\n",
+                   op->batch_fn, ln, l(ec));
+            return 1;
+        }
+        if ((! op->no_destin) &&
+            path_contains_canon(ms.source_pt.native(),
+                                ms.destination_pt.native())) {
+            pr_err(-1, "--batch={} line {}: SPATH contains DPATH{}\n",
+                   op->batch_fn, ln, l());
+            return 1;
+        }
+        ms.label = op->no_destin ? s(ms.source_pt) :
+                           s(ms.source_pt) + " -> " + s(ms.destination_pt);
+        ms_v.push_back(std::move(ms));
+    }
+    if (ms_v.empty()) {
+        pr_err(-1, "--batch={}: no SPATH found{}\n", op->batch_fn, l());
+        return 1;
+    }
+    return 0;
+}
+
+// Options not given on the command line take their defaults from the
+// profile of SPATH's file system, or from the one named by --profile=PNAME .
+// Returns 0 on success else 1 .
+static int
+apply_src_profile(struct opts_t * op) noexcept
+{
+    struct mut_opts_t * omutp { op->mutp };
+    const pfs_prof_t * pp { };
+    struct stat root_stat;
+
+    if (stat(op->source_pt.c_str(), &root_stat) < 0) {
+        pr_err(-1, "stat({}) failed{}\n", s(op->source_pt),
+               l(std::error_code(errno, std::system_category())));
+        return 1;
+    }
+    if (op->prof_cli) {
+        if (0 == strcmp(op->prof_cli, "none")) {
+            omutp->pfs_off = true;
+            return 0;
+        }
+        for (const auto & prof : pfs_prof_tbl) {
+            if (0 == strcmp(op->prof_cli, prof.name)) {
+                pp = &prof;
+                break;
+            }
+        }
+        if (pp == nullptr) {
+            pr_err(-1, "--profile={} unknown, try one of:", op->prof_cli);
+            for (const auto & prof : pfs_prof_tbl)
+                pr_err(-1, " {}", prof.name);
+            pr_err(-1, " none\n");
+            return 1;
+        }
+        omutp->dev_prof_v.emplace_back(root_stat.st_dev, pp);
+    } else {
+        pp = pfs_prof_dev(root_stat.st_dev, op->source_pt.c_str(), op);
+        if (pp == nullptr)
+            return 0;
+    }
+    if ((! op->reglen_given) && (! op->procfs_given) && (! op->cgroup_given))
+        op->reglen = pp->reglen;
+    if (! op->jobs_given)
+        op->jobs = pp->jobs ? pp->jobs
+                            : std::max(std::thread::hardware_concurrency(),
+                                       1U);
+    if (pp->no_xdev)
+        op->no_xdev = true;
+    if (pp->trace_mode && (op->cache_op_num == 0)) {
+        // so per_cpu buffers are read in parallel during the source scan
+        op->cache_op_num = 2;
+        pr_err(0, ">> since SPATH is tracefs, set --cache twice "
+               "implicitly{}\n", l());
+    }
+    pr_err(1, "SPATH profile: {}, reglen={}, wait={}, jobs={}, "
+           "no_xdev={}\n", pp->name, op->reglen,
+           op->wait_given ? static_cast<int>(op->wait_ms) : pp->wait_ms,
+           op->jobs, op->no_xdev);
+    return 0;
+}
+
+template <typename T>
+static void
+run_unique_and_erase(std::vector<T> &v)
+{
+#if __clang__ && (__clang_major__ < 16)
+// #warning ">>> got CLANG 15"
+    // CLANG 15.x has issue with std::ranges::unique() so fallback
+    // tp std::unique()
+    const auto ret { std::unique(v.begin(), v.end()) };
+    v.erase(ret, v.end());
+#else
+// #warning ">>> not CLANG 15"
+    // std::ranges::unique() returns a sub-range
+    const auto [new_log_end, old_end] { std::ranges::unique(v) };
+    v.erase(new_log_end, old_end);
+#endif
+}
+
+// Called from main() to resolve SPATH and DPATH, from the command line or
+// their defaults, into op->source_pt and op->destination_pt . DPATH is
+// created if it does not exist but its parent does. Returns 0 on success
+// else 1 .
+static int
+src_dst_setup(struct opts_t * op) noexcept
+{
+    int res { };
+    std::error_code ec { };
+
+    // expect source to be either an existing directory or a symlink to
+    // an existing directory.
+    if (op->source_given) {
+        auto sz = strlen(op->src_cli);
+        if (sz > 1) {       // chop off any trailing '/'
+            if ('/' == op->src_cli[sz - 1])
+                --sz;
+        }
+        fs::path pt { sstring(op->src_cli, op->src_cli + sz) };
+
+        if (pt.is_absolute())
+            op->source_pt = pt.lexically_normal();
+        else {
+            op->source_pt = fs::absolute(pt, ec).lexically_normal();
+            if (ec) {
+                pr_err(-1, "fs::absolute({}) failed{}\n", s(pt), l(ec));
+                return 1;
+            }
+        }
+        auto str { s(op->source_pt) };
+        sz = str.size();
+        if ((sz > 1) && ('/' == str[sz - 1]))
+             str.erase(str.end() - 1, str.end());
+        op->source_pt = str;
+    } else    // expect these roots to be absolute paths
+        op->source_pt = op->procfs_given ? procfs_root :
+                        (op->cgroup_given ? cgroup_root : sysfs_root);
+    fs::file_status src_fstatus { fs::status(op->source_pt, ec) };
+
+    if (ec) {
+        pr_err(-1, "default SPATH: {} problem{}\n", s(op->source_pt), l(ec));
+        return 1;
+    }
+    if (! fs::is_directory(src_fstatus)) {
+        pr_err(-1, "expected SPATH: {} to be a directory, or a symlink to "
+               "a directory\n", s(op->source_pt));
+        return 1;
+    }
+    res = apply_src_profile(op);
+    if (res)
+        return res;
+
+    auto src_sz = s(op->source_pt).size();
+    if ((src_sz == 1) && (s(op->source_pt)[0] == '/'))
+        src_sz = 0;
+    op->mutp->starting_src_sz = src_sz;
+
+    if (! op->no_destin) {
+        sstring d_str;
+
+        if (op->destination_given) {
+            auto sz = strlen(op->dst_cli);
+            if (sz > 1) {       // chop off any trailing '/'
+                if ('/' == op->dst_cli[sz - 1])
+                    --sz;
+            }
+            d_str = sstring(op->dst_cli, op->dst_cli + sz);
+        } else if (op->source_given) {
+            pr_err(-1, "When --source= given, need also to give "
+                   "--destination= (or --no-dst){}\n", l());
+            return 1;
+        } else
+            d_str = op->procfs_given ? def_proc_destin_root :
+                    (op->cgroup_given ? def_cgrp_destin_root
+                                      : def_destin_root);
+        if (d_str.size() == 0) {
+            pr_err(-1, "Confused, what is destination? [Got empty "
+                   "string]{}\n", l());
+            return 1;
+        }
+        fs::path d_pt { d_str };
+
+        if (d_pt.is_relative()) {
+            auto cur_pt { fs::current_path(ec) };
+            if (ec) {
+                pr_err(-1, "unable to get current path of destination, "
+                       "exit{}\n", l(ec));
+                return 1;
+            }
+            d_pt = cur_pt / d_pt;
+        }
+        if (d_pt.filename().empty())
+            d_pt = d_pt.parent_path(); // to handle trailing / as in /tmp/sys/
+        if (fs::exists(d_pt, ec)) {
+            if (fs::is_directory(d_pt, ec)) {
+                op->destination_pt = fs::canonical(d_pt, ec);
+                if (ec) {
+                    pr_err(-1, "canonical({}) failed{}\n", s(d_pt), l(ec));
+                    return 1;
+                }
+            } else {
+                pr_err(-1, "{}: is not a directory\n", s(d_pt), l());
+                return 1;
+            }
+        } else {
+            fs::path d_p_pt { d_pt.parent_path() };
+
+            if (fs::exists(d_p_pt, ec) && fs::is_directory(d_p_pt, ec)) {
+                // create destination directory at DPATH
+                // no problem if already exists
+                fs::create_directory(d_pt, ec);
+                if (ec) {
+                    pr_err(-1, "create_directory({}) failed{}\n", s(d_pt),
+                           l(ec));
+                    return 1;
+                }
+                pr_err(0, "In DPATH directory: {} created a new directory: "
+                       "{}\n", s(d_p_pt), s(d_pt.filename()));
+                op->destination_pt = fs::canonical(d_pt, ec);
+                op->destin_all_new = true;
+                if (ec) {
+                    pr_err(-1, "canonical({}) failed{}\n", s(d_pt), l(ec));
+                    return 1;
+                }
+            } else {
+                pr_err(-1, "{}: needs to be an existing directory{}\n",
+                       s(d_p_pt), l(ec));
+                return 1;
+            }
+        }
+        pr_err(5, "op->source_pt: {} , op->destination_pt: {}\n",
+                    s(op->source_pt), s(op->destination_pt));
+        if (op->source_pt == op->destination_pt) {
+            pr_err(-1, "source: {}, and destination: {} seem to be the same. "
+                   "That is not practical\n", s(op->source_pt),
+                   s(op->destination_pt));
+            return 1;
+        }
+    } else {
+        if (op->destination_given) {
+            pr_err(-1, "the --destination= and the --no-dst options "
+                   "contradict, please pick one{}\n", l());
+            return 1;
+        }
+        if (! op->mutp->deref_v.empty())
+            pr_err(-1, "Warning: --dereference=SYML options ignored when "
+                   "--no-destin option given\n");
     }
-    secs = total_ms / 1000;
-    ms_remainder = total_ms % 1000;
-    snprintf(b, sizeof(b), "%d.%03d", static_cast<int>(secs),
-             static_cast<int>(ms_remainder));
-    scout << "Total processing time: " << b << " seconds\n";
-
-    if (op->want_stats > 0)
-        show_stats(op);
-    return ec;
+    return 0;
 }
 
-static void
-run_unique_and_erase(std::vector<sstring> &v)
+// Decodes the comma separated list of filenames given to --procfs=FSET
+// or --cgroup=FSET (opt_nm) into fset_v. If task_p is given, 'task' sets
+// it rather than being a filename. Returns false on a bad filename.
+static bool
+fset_decode(const char * arg, const char * opt_nm,
+            std::vector<sstring> & fset_v, bool * task_p) noexcept
 {
-#if __clang__ && (__clang_major__ < 16)
-// #warning ">>> got CLANG 15"
-    // CLANG 15.x has issue with std::ranges::unique() so fallback
-    // tp std::unique()
-    const auto ret { std::unique(v.begin(), v.end()) };
-    v.erase(ret, v.end());
-#else
-// #warning ">>> not CLANG 15"
-    // std::ranges::unique() returns a sub-range
-    const auto [new_log_end, old_end] { std::ranges::unique(v) };
-    v.erase(new_log_end, old_end);
-#endif
+    for (const auto & tok : std::views::split(std::string_view(arg), ',')) {
+        const std::string_view fn(tok.begin(), tok.end());
+
+        if (task_p && (fn == "task"))
+            *task_p = true;
+        else if (fn.empty() || (fn.find('/') != fn.npos) || (fn == ".") ||
+                 (fn == "..")) {
+            pr_err(-1, "--{}=FSET expects filenames, not: '{}'{}\n", opt_nm,
+                   fn, l());
+            return false;
+        } else
+            fset_v.emplace_back(fn);
+    }
+    return true;
 }
 
 static int
@@ -3330,15 +7096,26 @@ parse_cmd_line(struct opts_t * op, int argc,  char * argv[])
 
     while ( true ) {
         int option_index { 0 };
-        int c { getopt_long(argc, argv, "cd:De:E:hHm:Np:r:R:s:SvVw:x",
+        int c { getopt_long(argc, argv,
+                            "ab:cCd:De:E:F:G::hHi:j:k:l:m:M::n:No:Op:"
+                            "P::r:R:s:ST:uvVw:x",
                             long_options, &option_index) };
         if (c == -1)
             break;
 
         switch (c) {
+        case 'a':
+            op->preserve = true;
+            break;
+        case 'b':
+            op->batch_fn = optarg;
+            break;
         case 'c':
             ++op->cache_op_num;
             break;
+        case 'C':
+            op->compact_num = true;
+            break;
         case 'd':
             if (op->destination_given) {
                 pr_err(-1, "only one destination location option can be "
@@ -3372,12 +7149,40 @@ parse_cmd_line(struct opts_t * op, int argc,  char * argv[])
             op->excl_fn_v.push_back(optarg);
             op->excl_fn_given = true;
             break;
+        case 'F':
+            op->prof_cli = optarg;
+            break;
+        case 'G':
+            op->cgroup_given = true;
+            if (optarg && (! fset_decode(optarg, "cgroup",
+                                         op->cgroup_fset_v, nullptr)))
+                return 1;
+            break;
         case 'h':
             help_request = true;
             break;
         case 'H':
             op->clone_hidden = true;
             break;
+        case 'i':
+            op->sqfs_fn = optarg;
+            break;
+        case 'j':
+            if (1 != sscanf(optarg, "%u", &op->jobs)) {
+                pr_err(-1, "unable to decode integer for --jobs=NJ{}\n",
+                       l());
+                return 1;
+            }
+            if (op->jobs == 0)
+                op->jobs = std::max(std::thread::hardware_concurrency(), 1U);
+            op->jobs_given = true;
+            break;
+        case 'k':
+            op->rollover_cli = optarg;
+            break;
+        case 'l':
+            op->log_fn = optarg;
+            break;
         case 'm':
             if (1 != sscanf(optarg, "%d", &op->max_depth)) {
                 pr_err(-1, "unable to decode integer for "
@@ -3389,9 +7194,37 @@ parse_cmd_line(struct opts_t * op, int argc,  char * argv[])
                 op->max_depth_active = true;
             }
             break;
+        case 'M':
+            op->dev_mf_given = true;
+            op->dev_mf_fn = optarg;
+            break;
+        case 'n':
+            for (const auto & tok :
+                 std::views::split(std::string_view(optarg), ',')) {
+                const std::string_view pid_sv(tok.begin(), tok.end());
+                pid_t pid { };
+                const auto [ptr, err] {
+                        std::from_chars(pid_sv.data(),
+                                        pid_sv.data() + pid_sv.size(), pid) };
+
+                if ((err != std::errc()) ||
+                    (ptr != pid_sv.data() + pid_sv.size()) || (pid < 1)) {
+                    pr_err(-1, "--ns-pid= expects PIDs, not: '{}'{}\n",
+                           pid_sv, l());
+                    return 1;
+                }
+                op->ns_pid_v.push_back(pid);
+            }
+            break;
         case 'N':
             op->no_xdev = true;
             break;
+        case 'o':
+            op->col_dn = optarg;
+            break;
+        case 'O':
+            op->sort_sdirs = true;
+            break;
         case 'p':
             op->prune_given = true;
             if (fs::is_symlink(optarg, ec))
@@ -3403,12 +7236,21 @@ parse_cmd_line(struct opts_t * op, int argc,  char * argv[])
             else
                 op->mutp->prune_v.push_back(s(l_pt));
             break;
+        case 'P':
+            op->procfs_given = true;
+            if (optarg == nullptr)
+                break;
+            if (! fset_decode(optarg, "procfs", op->procfs_fset_v,
+                              &op->procfs_task))
+                return 1;
+            break;
         case 'r':
             if (1 != sscanf(optarg, "%u", &op->reglen)) {
                 pr_err(-1, "unable to decode integer for --reglen=RLEN{}\n",
                        l());
                 return 1;
             }
+            op->reglen_given = true;
             break;
         case 'R':
             op->deref_given = true;
@@ -3433,6 +7275,12 @@ parse_cmd_line(struct opts_t * op, int argc,  char * argv[])
         case 'S':
             ++op->want_stats;
             break;
+        case 'T':
+            op->table_fn = optarg;
+            break;
+        case 'u':
+            op->dedup = true;
+            break;
         case 'v':
             ++cpf_verbose;
             ++op->verbose;
@@ -3510,151 +7358,157 @@ main(int argc, char * argv[])
     int glob_opt;
     std::error_code ec { };
     glob_t ex_paths { };
+    std::vector<multi_src_t> ms_v;     // --batch=BFILE lines
     struct opts_t opts { };
     struct opts_t * op = &opts;
     struct mut_opts_t mut_opts { };
     fs::path l_pt;
 
     op->mutp = &mut_opts;
+    op->mutp->arenap = &contents_arena;
     struct stats_t * q { &op->mutp->stats };
     op->reglen = def_reglen;
+    op->jobs = 1;
 
     res = parse_cmd_line(op, argc, argv);
     if (res)
         return (res < 0) ? 0 : res;
-
-    // expect source to be either an existing directory or a symlink to
-    // an existing directory.
-    if (op->source_given) {
-        auto sz = strlen(op->src_cli);
-        if (sz > 1) {       // chop off any trailing '/'
-            if ('/' == op->src_cli[sz - 1])
-                --sz;
+    if (op->procfs_given) {
+        if (op->procfs_fset_v.empty())
+            op->procfs_fset_v.assign(std::begin(def_procfs_fset),
+                                     std::end(def_procfs_fset));
+        if (! op->reglen_given)
+            op->reglen = def_proc_reglen;
+        if ((op->cache_op_num > 0) || op->prune_given ||
+            op->exclude_given || op->excl_fn_given || op->deref_given ||
+            op->max_depth_active)
+            pr_err(0, ">> --procfs ignores --cache, --prune=, --exclude=, "
+                   "--excl-fn=, --deref= and --max-depth={}\n", l());
+    }
+    if (op->cgroup_given) {
+        if (op->procfs_given) {
+            pr_err(-1, "the --cgroup and the --procfs options contradict, "
+                   "please pick one{}\n", l());
+            return 1;
         }
-        fs::path pt { sstring(op->src_cli, op->src_cli + sz) };
-
-        if (pt.is_absolute())
-            op->source_pt = pt.lexically_normal();
-        else {
-            op->source_pt = fs::absolute(pt, ec).lexically_normal();
-            if (ec) {
-                pr_err(-1, "fs::absolute({}) failed{}\n", s(pt), l(ec));
-                return 1;
-            }
+        if (op->cgroup_fset_v.empty())
+            op->cgroup_fset_v.assign(std::begin(def_cgroup_fset),
+                                     std::end(def_cgroup_fset));
+        if (! op->reglen_given)
+            op->reglen = def_cgrp_reglen;
+        // the table replaces the tree unless DPATH is given
+        if (op->table_fn && (! op->destination_given))
+            op->no_destin = true;
+        if ((op->cache_op_num > 0) || op->prune_given ||
+            op->exclude_given || op->excl_fn_given || op->deref_given ||
+            op->max_depth_active)
+            pr_err(0, ">> --cgroup ignores --cache, --prune=, --exclude=, "
+                   "--excl-fn=, --deref= and --max-depth={}\n", l());
+    } else if (op->table_fn)
+        pr_err(0, ">> --table= has no effect without --cgroup{}\n", l());
+    if (op->sqfs_fn) {
+        if (op->procfs_given || op->cgroup_given) {
+            op->sqfs_fn = nullptr;
+            pr_err(0, ">> --squashfs= has no effect with --procfs or "
+                   "--cgroup{}\n", l());
+        } else if (! op->destination_given)
+            op->no_destin = true;   // the image replaces the DPATH tree
+    }
+    if (! op->ns_pid_v.empty()) {
+        if (op->procfs_given || op->cgroup_given) {
+            pr_err(-1, "--ns-pid= cannot be used with --procfs or "
+                   "--cgroup{}\n", l());
+            return 1;
         }
-        auto str { s(op->source_pt) };
-        sz = str.size();
-        if ((sz > 1) && ('/' == str[sz - 1]))
-             str.erase(str.end() - 1, str.end());
-        op->source_pt = str;
-    } else { // expect sysfs_root to be an absolute path
-        op->source_pt = sysfs_root;
+        // those options name paths as seen in this mount namespace
+        if (op->exclude_given || op->prune_given || op->deref_given) {
+            pr_err(-1, "--ns-pid= cannot be used with --exclude=, "
+                   "--prune= or --deref={}\n", l());
+            return 1;
+        }
+        std::ranges::sort(op->ns_pid_v);
+        run_unique_and_erase(op->ns_pid_v);
     }
-    fs::file_status src_fstatus { fs::status(op->source_pt, ec) };
-
-    if (ec) {
-        pr_err(-1, "default SPATH: {} problem{}\n", s(op->source_pt), l(ec));
-        return 1;
+    if (op->batch_fn) {
+        if (op->source_given || op->destination_given ||
+            (! op->ns_pid_v.empty()) || op->procfs_given ||
+            op->cgroup_given) {
+            pr_err(-1, "--batch= cannot be used with --source=, "
+                   "--destination=, --ns-pid=, --procfs or --cgroup{}\n",
+                   l());
+            return 1;
+        }
+        if (op->exclude_given || op->prune_given || op->deref_given) {
+            pr_err(-1, "--batch= cannot be used with --exclude=, "
+                   "--prune= or --deref={}\n", l());
+            return 1;
+        }
     }
-    if (! fs::is_directory(src_fstatus)) {
-        pr_err(-1, "expected SPATH: {} to be a directory, or a symlink to "
-               "a directory\n", s(op->source_pt));
-        return 1;
+    if (op->log_fn) {
+        // cpf_alog's destructor drains the rings and closes LFILE
+        res = cpf_alog.start(op->log_fn);
+        if (res) {
+            ec.assign(res, std::system_category());
+            pr_err(-1, "unable to start logging to {}{}\n", op->log_fn,
+                   l(ec));
+            return 1;
+        }
     }
 
-    auto src_sz = s(op->source_pt).size();
-    if ((src_sz == 1) && (s(op->source_pt)[0] == '/'))
-        src_sz = 0;
-    op->mutp->starting_src_sz = src_sz;
-
-    if (! op->no_destin) {
-        sstring d_str;
+    res = op->batch_fn ? batch_load(op, ms_v) : src_dst_setup(op);
+    if (res)
+        return res;
 
-        if (op->destination_given) {
-            auto sz = strlen(op->dst_cli);
-            if (sz > 1) {       // chop off any trailing '/'
-                if ('/' == op->dst_cli[sz - 1])
-                    --sz;
+    if (op->dev_mf_given) {
+        if (op->no_destin || op->procfs_given || op->cgroup_given)
+            pr_err(0, ">> --dev-manifest has no effect without a "
+                   "DPATH clone{}\n", l());
+        else if (op->ns_pid_v.empty() && (! op->batch_fn)) {
+            // otherwise one per clone, see do_multi_src()
+            const sstring mf_s { op->dev_mf_fn ? sstring(op->dev_mf_fn) :
+                        (op->destination_pt / def_dev_mf_fn).native() };
+            FILE * fp { dev_manifest_open(mf_s, op) };
+
+            if (fp == nullptr) {
+                ec.assign(errno, std::system_category());
+                pr_err(-1, "unable to open --dev-manifest={}{}\n", mf_s,
+                       l(ec));
+                return 1;
             }
-            d_str = sstring(op->dst_cli, op->dst_cli + sz);
-        } else if (op->source_given) {
-            pr_err(-1, "When --source= given, need also to give "
-                   "--destination= (or --no-dst){}\n", l());
-            return 1;
-        } else
-            d_str = def_destin_root;
-        if (d_str.size() == 0) {
-            pr_err(-1, "Confused, what is destination? [Got empty "
-                   "string]{}\n", l());
-            return 1;
+            op->mutp->dev_mf_fp = fp;
         }
-        fs::path d_pt { d_str };
+    }
 
-        if (d_pt.is_relative()) {
-            auto cur_pt { fs::current_path(ec) };
-            if (ec) {
-                pr_err(-1, "unable to get current path of destination, "
-                       "exit{}\n", l(ec));
+    if (op->rollover_cli) {
+        if (op->no_destin || op->procfs_given || op->cgroup_given)
+            pr_err(0, ">> --rollover= has no effect without a DPATH "
+                   "clone{}\n", l());
+        else if (op->batch_fn) {
+            pr_err(-1, "--rollover= cannot be used with --batch={}\n", l());
+            return 1;
+        } else {
+            const auto & d_s { op->destination_pt.native() };
+
+            op->rollover_pt = fs::canonical(op->rollover_cli, ec);
+            if (ec || (! fs::is_directory(op->rollover_pt, ec))) {
+                pr_err(-1, "--rollover={}: needs to be an existing "
+                       "directory{}\n", op->rollover_cli, l(ec));
                 return 1;
             }
-            d_pt = cur_pt / d_pt;
-        }
-        if (d_pt.filename().empty())
-            d_pt = d_pt.parent_path(); // to handle trailing / as in /tmp/sys/
-        if (fs::exists(d_pt, ec)) {
-            if (fs::is_directory(d_pt, ec)) {
-                op->destination_pt = fs::canonical(d_pt, ec);
-                if (ec) {
-                    pr_err(-1, "canonical({}) failed{}\n", s(d_pt), l(ec));
-                    return 1;
-                }
-            } else {
-                pr_err(-1, "{}: is not a directory\n", s(d_pt), l());
+            // else PREV files could be truncated before being cloned
+            if (path_contains_canon(op->rollover_pt.native(), d_s) ||
+                path_contains_canon(d_s, op->rollover_pt.native())) {
+                pr_err(-1, "--rollover={}: PREV and DPATH must not "
+                       "overlap{}\n", op->rollover_cli, l());
                 return 1;
             }
-        } else {
-            fs::path d_p_pt { d_pt.parent_path() };
+            struct statfs a_statfs;
 
-            if (fs::exists(d_p_pt, ec) && fs::is_directory(d_p_pt, ec)) {
-                // create destination directory at DPATH
-                // no problem if already exists
-                fs::create_directory(d_pt, ec);
-                if (ec) {
-                    pr_err(-1, "create_directory({}) failed{}\n", s(d_pt),
-                           l(ec));
-                    return 1;
-                }
-                pr_err(0, "In DPATH directory: {} created a new directory: "
-                       "{}\n", s(d_p_pt), s(d_pt.filename()));
-                op->destination_pt = fs::canonical(d_pt, ec);
-                op->destin_all_new = true;
-                if (ec) {
-                    pr_err(-1, "canonical({}) failed{}\n", s(d_pt), l(ec));
-                    return 1;
-                }
-            } else {
-                pr_err(-1, "{}: needs to be an existing directory{}\n",
-                       s(d_p_pt), l(ec));
-                return 1;
-            }
-        }
-        pr_err(5, "op->source_pt: {} , op->destination_pt: {}\n",
-                    s(op->source_pt), s(op->destination_pt));
-        if (op->source_pt == op->destination_pt) {
-            pr_err(-1, "source: {}, and destination: {} seem to be the same. "
-                   "That is not practical\n", s(op->source_pt),
-                   s(op->destination_pt));
-            return 1;
-        }
-    } else {
-        if (op->destination_given) {
-            pr_err(-1, "the --destination= and the --no-dst options "
-                   "contradict, please pick one{}\n", l());
-            return 1;
+            op->rollover_min = (statfs(d_s.c_str(), &a_statfs) == 0) ?
+                    static_cast<unsigned int>(a_statfs.f_bsize) : 4096;
+            pr_err(1, "--rollover: files under {} bytes written{}\n",
+                   op->rollover_min, l());
         }
-        if (! op->mutp->deref_v.empty())
-            pr_err(-1, "Warning: --dereference=SYML options ignored when "
-                   "--no-destin option given\n");
     }
 
     if (op->reglen > def_reglen) {
@@ -3720,7 +7574,8 @@ main(int argc, char * argv[])
                     pr_err(-1, "{}: exclude path rejected{}\n", s(ex_pt),
                            l(ec));
                 } else {
-                    if (path_contains_canon(op->source_pt, c_ex_pt)) {
+                    if (path_contains_canon(op->source_pt.native(),
+                                            c_ex_pt.native())) {
                         op->mutp->glob_exclude_v.push_back(s(ex_pt));
                         pr_err(5, "accepted canonical exclude path: {}\n",
                                s(ex_pt));
@@ -3766,7 +7621,8 @@ main(int argc, char * argv[])
         }
         bool prun_1_is_contained {};
         for (const auto & tt : op->mutp->prune_v) {
-            prun_1_is_contained = path_contains_canon(op->source_pt, tt);
+            prun_1_is_contained =
+                        path_contains_canon(op->source_pt.native(), tt);
             if (prun_1_is_contained)
                 break;
         }
@@ -3794,8 +7650,10 @@ main(int argc, char * argv[])
         }
     }
 
-    if (! op->no_destin) {
-        if (path_contains_canon(op->source_pt, op->destination_pt)) {
+    // batch_load() has checked each line's SPATH and DPATH
+    if ((! op->no_destin) && (! op->batch_fn)) {
+        if (path_contains_canon(op->source_pt.native(),
+                                op->destination_pt.native())) {
             pr_err(-1, "Source contains destination, infinite recursion "
                    "possible{}\n", l());
             if ((op->max_depth == 0) && (ex_sz == 0)) {
@@ -3809,7 +7667,8 @@ main(int argc, char * argv[])
             if (cpf_verbose > 0)
                 pr_err(-1, "Source does NOT contain destination (good){}\n",
                        l());
-            if (path_contains_canon(op->destination_pt, op->source_pt)) {
+            if (path_contains_canon(op->destination_pt.native(),
+                                    op->source_pt.native())) {
                 pr_err(-1, "Strange: destination contains source, is "
                        "infinite recursion possible ?{}\n", l());
                 pr_err(2, "destination does NOT contain source (also "
@@ -3839,7 +7698,8 @@ main(int argc, char * argv[])
                 const auto lpath { parent_pt / lnk_name };
                 // following should remove .. components in path
                 const auto npath { lpath.lexically_normal() };
-                if (path_contains_canon(op->source_pt, npath) &&
+                if (path_contains_canon(op->source_pt.native(),
+                                        npath.native()) &&
                            (op->source_pt != sl)) {
                     const auto ftyp { fs::symlink_status(npath, ec).type() };
 
@@ -3886,61 +7746,104 @@ main(int argc, char * argv[])
         }
 
     }
-
-    if (op->cache_op_num > 0) {
-        inmem_dir_t s_inm_rt(op->source_pt.filename(), short_stat());
-        struct stat root_stat;
-
-        s_inm_rt.is_root = 1;
-        fs::path s_p_pt { op->source_pt.parent_path() };
-        if (0 == s_p_pt.compare(op->source_pt.root_path())) {
-            s_inm_rt.par_pt_s.clear();
-        } else {
-            s_inm_rt.par_pt_s = s_p_pt;
+    if (op->preserve) {
+        if (op->no_destin || op->procfs_given || op->cgroup_given) {
+            op->preserve = false;
+            pr_err(0, ">> --preserve has no effect without a DPATH "
+                   "clone{}\n", l());
+        } else if (op->cache_op_num == 0) {
+            // metadata is taken from the lstat() of the caching scan
+            ++op->cache_op_num;
+            pr_err(0, ">> since --preserve given, set --cache "
+                   "implicitly{}\n", l());
         }
-
-        s_inm_rt.depth = -1;
-        if (stat(op->source_pt.c_str(), &root_stat) < 0) {
-            ec.assign(errno, std::system_category());
-            pr_err(-1, "stat(source) failed{}\n", l(ec));
+    }
+    if (op->dedup) {
+        if (op->preserve) {
+            // hard links share one owner, permissions and times
+            pr_err(-1, "the --dedup and the --preserve options contradict, "
+                   "please pick one{}\n", l());
             return 1;
         }
-        op->mutp->starting_fs_inst = root_stat.st_dev;
-
-        // auto * rt_dirp { &s_inm_rt };
-        s_inm_rt.shstat.st_dev = root_stat.st_dev;
-        s_inm_rt.shstat.st_mode = root_stat.st_mode;
-        if (op->prune_given)
-            s_inm_rt.prune_mask = prune_up_chain;
-        inmem_t src_rt_cache(s_inm_rt);
-        op->mutp->cache_rt_dirp = std::get_if<inmem_dir_t>(&src_rt_cache);
-
-        if (cpf_verbose > 4) {
-            pr_err(4, ">>> initial, empty cache tree:");
-            show_cache(src_rt_cache, true, op);
+        if (op->no_destin || op->procfs_given || op->cgroup_given) {
+            op->dedup = false;
+            pr_err(0, ">> --dedup has no effect without a DPATH "
+                   "clone{}\n", l());
         }
-        ec = do_cache(src_rt_cache, op);  // src ==> cache ==> destination
+    }
+    if (op->sort_sdirs) {
+        if (op->procfs_given || op->cgroup_given) {
+            op->sort_sdirs = false;
+            pr_err(0, ">> --sort has no effect with --procfs or "
+                   "--cgroup{}\n", l());
+        } else if (op->cache_op_num == 0) {
+            // only the cache tree can be put in order before the unroll
+            ++op->cache_op_num;
+            pr_err(0, ">> since --sort given, set --cache implicitly{}\n",
+                   l());
+        }
+    }
+    if (op->col_dn) {
+        if (op->procfs_given || op->cgroup_given) {
+            op->col_dn = nullptr;
+            pr_err(0, ">> --columnar= has no effect with --procfs or "
+                   "--cgroup{}\n", l());
+        } else if (op->cache_op_num < 2) {
+            op->cache_op_num = 2;
+            pr_err(0, ">> since --columnar= given, set --cache twice "
+                   "implicitly{}\n", l());
+        }
+    }
+    if (op->sqfs_fn && (op->cache_op_num < 2)) {
+        op->cache_op_num = 2;
+        pr_err(0, ">> since --squashfs= given, set --cache twice "
+               "implicitly{}\n", l());
+    }
+    if (op->compact_num && (op->cache_op_num < 2))
+        pr_err(0, ">> --compact has no effect unless --cache is given "
+               "twice{}\n", l());
+    if (op->jobs_given && (op->jobs > 1) && (op->cache_op_num == 0) &&
+        (! op->procfs_given) && (! op->cgroup_given) &&
+        op->ns_pid_v.empty() && (! op->batch_fn))
+        pr_err(0, ">> --jobs= has no effect without --cache{}\n", l());
+    select_scan_pol(op);
+
+    if (op->procfs_given) {
+        ec = do_procfs(op);
+        if (ec)
+            res = 1;
+    } else if (op->cgroup_given) {
+        ec = do_cgroup(op);
+        if (ec)
+            res = 1;
+    } else if (! op->ns_pid_v.empty()) {
+        ec = do_ns_pid(op);
+        if (ec)
+            res = 1;
+    } else if (op->batch_fn) {
+        ec = do_multi_src(ms_v, std::max(std::thread::hardware_concurrency(),
+                                         1U), true, op);
         if (ec)
             res = 1;
-        if (cpf_verbose > 4) {
-            pr_err(4, ">>> final cache tree:\n");
-            show_cache(src_rt_cache, true, op);
-        }
     } else {
-        ec = do_clone(op);      // Single pass
-        if (ec) {
+        ec = do_clone_src(op);
+        if (ec)
             res = 1;
-            pr_err(-1, "do_clone() failed{}\n", l());
-        }
+    }
+    if (op->mutp->dev_mf_fp && (fclose(op->mutp->dev_mf_fp) != 0)) {
+        pr_err(-1, "problem closing --dev-manifest file{}\n",
+               l(std::error_code(errno, std::system_category())));
+        res = 1;
     }
     if ((op->want_stats == 0) && (op->destination_given == false) &&
-        (op->source_given == false) && (op->no_destin == false)) {
+        (op->source_given == false) && (op->no_destin == false) &&
+        (op->batch_fn == nullptr)) {
         if (res == 0)
-            scout << "Successfully cloned " << sysfs_root << " to "
-                  << def_destin_root << "\n";
+            scout << "Successfully cloned " << s(op->source_pt) << " to "
+                  << s(op->destination_pt) << "\n";
         else
-            scout << "Problem cloning " << sysfs_root << " to "
-                  << def_destin_root << "\n";
+            scout << "Problem cloning " << s(op->source_pt) << " to "
+                  << s(op->destination_pt) << "\n";
     }
     if ((! op->want_stats) && (q->num_scan_failed > 0)) {
         pr_err(-1, "Warning: scan of source truncated, may need to "
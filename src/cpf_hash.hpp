@@ -0,0 +1,423 @@
+/*
+ * Copyright (c) 2023 Douglas Gilbert.
+ * All rights reserved.
+ * Use of this source code is governed by a BSD-style
+ * license that can be found in the BSD_LICENSE file.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Derived from the XXH3 64 bit hash of the xxHash library:
+ *   xxHash - Extremely Fast Hash algorithm
+ *   Copyright (c) 2012-2021 Yann Collet
+ *   All rights reserved.
+ *   BSD 2-Clause License (https://www.opensource.org/licenses/bsd-license.php)
+ *   https://github.com/Cyan4973/xxHash
+ */
+
+// cpf_hash.hpp  64 bit non-cryptographic hash for clone_pseudo_fs
+//
+// This is not a copy of xxhash.h and does not compute XXH3 values. It
+// follows the XXH3 construction and uses its prime constants: short inputs
+// use overlapping loads folded through 64x64->128 bit multiplies, long
+// inputs are accumulated 64 bytes (a "stripe") at a time into eight 64 bit
+// lanes which suit SSE2 and AVX2 registers. The secret (key material) here
+// is generated by splitmix64, so the output differs from XXH3; do not
+// compare these hash values with xxHash ones.
+//
+// Hash values are only meant to be compared within one host since the
+// multi-byte loads are in host byte order.
+
+#ifndef CPF_HASH_HPP
+#define CPF_HASH_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <array>
+#include <bit>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace cpf_hash {
+
+namespace detail {
+
+inline constexpr uint64_t prime32_1 { 0x9E3779B1U };
+inline constexpr uint64_t prime32_2 { 0x85EBCA77U };
+inline constexpr uint64_t prime32_3 { 0xC2B2AE3DU };
+inline constexpr uint64_t prime64_1 { 0x9E3779B185EBCA87ULL };
+inline constexpr uint64_t prime64_2 { 0xC2B2AE3D27D4EB4FULL };
+inline constexpr uint64_t prime64_3 { 0x165667B19E3779F9ULL };
+inline constexpr uint64_t prime64_4 { 0x85EBCA77C2B2AE63ULL };
+inline constexpr uint64_t prime64_5 { 0x27D4EB2F165667C5ULL };
+
+inline constexpr size_t secret_sz { 192 };
+inline constexpr size_t stripe_len { 64 };
+inline constexpr size_t secret_consume_rate { 8 };
+inline constexpr size_t stripes_per_block
+                { (secret_sz - stripe_len) / secret_consume_rate };
+inline constexpr size_t block_len { stripe_len * stripes_per_block };
+
+constexpr std::array<uint8_t, secret_sz>
+make_secret() noexcept
+{
+    std::array<uint8_t, secret_sz> res { };
+    uint64_t x { 0x636c6f6e655f7066ULL };       // "clone_pf"
+
+    for (size_t k = 0; k < secret_sz; k += 8) {
+        x += 0x9E3779B97F4A7C15ULL;             // splitmix64
+        uint64_t z { x };
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z ^= (z >> 31);
+        for (size_t j = 0; j < 8; ++j)
+            res[k + j] = static_cast<uint8_t>(z >> (8 * j));
+    }
+    return res;
+}
+
+inline constexpr std::array<uint8_t, secret_sz> secret { make_secret() };
+
+inline uint64_t
+read64(const uint8_t * p) noexcept
+{
+    uint64_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t
+read32(const uint8_t * p) noexcept
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+__extension__ using u128_t = unsigned __int128;  // quiet under -pedantic
+
+inline uint64_t
+mul128_fold64(uint64_t a, uint64_t b) noexcept
+{
+    const u128_t prod { static_cast<u128_t>(a) * b };
+
+    return static_cast<uint64_t>(prod) ^ static_cast<uint64_t>(prod >> 64);
+}
+
+inline uint64_t
+avalanche(uint64_t h) noexcept
+{
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+inline uint64_t
+rrmxmx(uint64_t h, uint64_t len) noexcept
+{
+    h ^= std::rotl(h, 49) ^ std::rotl(h, 24);
+    h *= 0x9FB21C651E98DF25ULL;
+    h ^= (h >> 35) + len;
+    h *= 0x9FB21C651E98DF25ULL;
+    return h ^ (h >> 28);
+}
+
+inline uint64_t
+mix16(const uint8_t * p, const uint8_t * s, uint64_t seed) noexcept
+{
+    return mul128_fold64(read64(p) ^ (read64(s) + seed),
+                         read64(p + 8) ^ (read64(s + 8) - seed));
+}
+
+inline uint64_t
+hash_0to16(const uint8_t * p, size_t len, uint64_t seed) noexcept
+{
+    const uint8_t * s { secret.data() };
+
+    if (len > 8) {
+        const uint64_t lo { read64(p) ^ ((read64(s + 24) ^ read64(s + 32)) +
+                                         seed) };
+        const uint64_t hi { read64(p + len - 8) ^
+                            ((read64(s + 40) ^ read64(s + 48)) - seed) };
+        const uint64_t acc { len + __builtin_bswap64(lo) + hi +
+                             mul128_fold64(lo, hi) };
+
+        return avalanche(acc);
+    }
+    if (len >= 4) {
+        const uint64_t in64 { read32(p + len - 4) +
+                              (static_cast<uint64_t>(read32(p)) << 32) };
+        const uint64_t keyed { in64 ^ ((read64(s + 8) ^ read64(s + 16)) -
+                                       seed) };
+
+        return rrmxmx(keyed, len);
+    }
+    if (len > 0) {
+        const uint32_t combined { (static_cast<uint32_t>(p[0]) << 16) |
+                                  (static_cast<uint32_t>(p[len >> 1]) << 24) |
+                                  static_cast<uint32_t>(p[len - 1]) |
+                                  (static_cast<uint32_t>(len) << 8) };
+        const uint64_t keyed { combined ^ ((read32(s) ^ read32(s + 4)) +
+                                           seed) };
+
+        return avalanche(keyed * prime64_1);
+    }
+    return avalanche(seed ^ read64(s + 56) ^ read64(s + 64));
+}
+
+inline uint64_t
+hash_17to128(const uint8_t * p, size_t len, uint64_t seed) noexcept
+{
+    const uint8_t * s { secret.data() };
+    uint64_t acc { len * prime64_1 };
+
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                acc += mix16(p + 48, s + 96, seed);
+                acc += mix16(p + len - 64, s + 112, seed);
+            }
+            acc += mix16(p + 32, s + 64, seed);
+            acc += mix16(p + len - 48, s + 80, seed);
+        }
+        acc += mix16(p + 16, s + 32, seed);
+        acc += mix16(p + len - 32, s + 48, seed);
+    }
+    acc += mix16(p, s, seed);
+    acc += mix16(p + len - 16, s + 16, seed);
+    return avalanche(acc);
+}
+
+// Long inputs: accumulate one stripe into acc[8], then scramble acc after
+// each block. The three implementations give identical results.
+
+inline void
+accumulate_scalar(uint64_t * acc, const uint8_t * p,
+                  const uint8_t * s) noexcept
+{
+    for (size_t i = 0; i < 8; ++i) {
+        const uint64_t data_val { read64(p + 8 * i) };
+        const uint64_t data_key { data_val ^ read64(s + 8 * i) };
+
+        acc[i ^ 1] += data_val;
+        acc[i] += (data_key & 0xFFFFFFFFU) * (data_key >> 32);
+    }
+}
+
+inline void
+scramble_scalar(uint64_t * acc, const uint8_t * s) noexcept
+{
+    for (size_t i = 0; i < 8; ++i) {
+        uint64_t a { acc[i] };
+
+        a ^= a >> 47;
+        a ^= read64(s + 8 * i);
+        acc[i] = a * prime32_1;
+    }
+}
+
+#if defined(__x86_64__)
+
+inline void
+accumulate_sse2(uint64_t * acc, const uint8_t * p, const uint8_t * s) noexcept
+{
+    __m128i * xacc { reinterpret_cast<__m128i *>(acc) };
+
+    for (size_t i = 0; i < 4; ++i) {
+        const __m128i data_vec
+                { _mm_loadu_si128(reinterpret_cast<const __m128i *>(p) + i) };
+        const __m128i key_vec
+                { _mm_loadu_si128(reinterpret_cast<const __m128i *>(s) + i) };
+        const __m128i data_key { _mm_xor_si128(data_vec, key_vec) };
+        const __m128i data_key_hi
+                { _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1)) };
+        const __m128i product { _mm_mul_epu32(data_key, data_key_hi) };
+        const __m128i data_swap
+                { _mm_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2)) };
+        const __m128i sum
+                { _mm_add_epi64(_mm_loadu_si128(xacc + i), data_swap) };
+
+        _mm_storeu_si128(xacc + i, _mm_add_epi64(product, sum));
+    }
+}
+
+inline void
+scramble_sse2(uint64_t * acc, const uint8_t * s) noexcept
+{
+    __m128i * xacc { reinterpret_cast<__m128i *>(acc) };
+    const __m128i prime32 { _mm_set1_epi32(static_cast<int>(prime32_1)) };
+
+    for (size_t i = 0; i < 4; ++i) {
+        __m128i a { _mm_loadu_si128(xacc + i) };
+        const __m128i key_vec
+                { _mm_loadu_si128(reinterpret_cast<const __m128i *>(s) + i) };
+
+        a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a = _mm_xor_si128(a, key_vec);
+        const __m128i a_hi { _mm_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)) };
+        const __m128i prod_lo { _mm_mul_epu32(a, prime32) };
+        const __m128i prod_hi { _mm_mul_epu32(a_hi, prime32) };
+
+        _mm_storeu_si128(xacc + i,
+                         _mm_add_epi64(prod_lo, _mm_slli_epi64(prod_hi, 32)));
+    }
+}
+
+__attribute__((target("avx2"))) inline void
+accumulate_avx2(uint64_t * acc, const uint8_t * p, const uint8_t * s) noexcept
+{
+    __m256i * xacc { reinterpret_cast<__m256i *>(acc) };
+
+    for (size_t i = 0; i < 2; ++i) {
+        const __m256i data_vec
+            { _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p) + i) };
+        const __m256i key_vec
+            { _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s) + i) };
+        const __m256i data_key { _mm256_xor_si256(data_vec, key_vec) };
+        const __m256i data_key_hi
+                { _mm256_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1)) };
+        const __m256i product { _mm256_mul_epu32(data_key, data_key_hi) };
+        const __m256i data_swap
+                { _mm256_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2)) };
+        const __m256i sum
+                { _mm256_add_epi64(_mm256_loadu_si256(xacc + i), data_swap) };
+
+        _mm256_storeu_si256(xacc + i, _mm256_add_epi64(product, sum));
+    }
+}
+
+__attribute__((target("avx2"))) inline void
+scramble_avx2(uint64_t * acc, const uint8_t * s) noexcept
+{
+    __m256i * xacc { reinterpret_cast<__m256i *>(acc) };
+    const __m256i prime32
+                { _mm256_set1_epi32(static_cast<int>(prime32_1)) };
+
+    for (size_t i = 0; i < 2; ++i) {
+        __m256i a { _mm256_loadu_si256(xacc + i) };
+        const __m256i key_vec
+            { _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s) + i) };
+
+        a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+        a = _mm256_xor_si256(a, key_vec);
+        const __m256i a_hi
+                { _mm256_shuffle_epi32(a, _MM_SHUFFLE(0, 3, 0, 1)) };
+        const __m256i prod_lo { _mm256_mul_epu32(a, prime32) };
+        const __m256i prod_hi { _mm256_mul_epu32(a_hi, prime32) };
+
+        _mm256_storeu_si256(xacc + i,
+                    _mm256_add_epi64(prod_lo, _mm256_slli_epi64(prod_hi, 32)));
+    }
+}
+
+#endif          // __x86_64__
+
+using accumulate_fn_t = void (*)(uint64_t *, const uint8_t *,
+                                 const uint8_t *) noexcept;
+using scramble_fn_t = void (*)(uint64_t *, const uint8_t *) noexcept;
+
+// Templated on the stripe functions. Always inlined so that the stripe
+// functions can in turn be inlined into the (target specific) callers.
+template <accumulate_fn_t Acc, scramble_fn_t Scr>
+[[gnu::always_inline]] inline uint64_t
+hash_long(const uint8_t * p, size_t len, uint64_t seed) noexcept
+{
+    alignas(32) uint64_t acc[8] { prime32_3, prime64_1, prime64_2, prime64_3,
+                                  prime64_4, prime32_2, prime64_5, prime32_1 };
+    const uint8_t * s { secret.data() };
+    const size_t nb_blocks { (len - 1) / block_len };
+
+    // fold the seed into the accumulators rather than into the secret
+    for (size_t i = 0; i < 8; i += 2) {
+        acc[i] += seed;
+        acc[i + 1] -= seed;
+    }
+    for (size_t b = 0; b < nb_blocks; ++b) {
+        const uint8_t * bp { p + (b * block_len) };
+
+        for (size_t n = 0; n < stripes_per_block; ++n)
+            Acc(acc, bp + (n * stripe_len), s + (n * secret_consume_rate));
+        Scr(acc, s + secret_sz - stripe_len);
+    }
+
+    // last partial block, then the last stripe which may overlap
+    const size_t nb_stripes
+                { ((len - 1) - (block_len * nb_blocks)) / stripe_len };
+    const uint8_t * bp { p + (nb_blocks * block_len) };
+
+    for (size_t n = 0; n < nb_stripes; ++n)
+        Acc(acc, bp + (n * stripe_len), s + (n * secret_consume_rate));
+    Acc(acc, p + len - stripe_len, s + secret_sz - stripe_len - 7);
+
+    uint64_t res { len * prime64_1 };
+
+    for (size_t i = 0; i < 4; ++i)
+        res += mul128_fold64(acc[2 * i] ^ read64(s + 11 + (16 * i)),
+                             acc[(2 * i) + 1] ^ read64(s + 19 + (16 * i)));
+    return avalanche(res);
+}
+
+inline uint64_t
+hash_long_scalar(const uint8_t * p, size_t len, uint64_t seed) noexcept
+{
+    return hash_long<accumulate_scalar, scramble_scalar>(p, len, seed);
+}
+
+#if defined(__x86_64__)
+
+inline uint64_t
+hash_long_sse2(const uint8_t * p, size_t len, uint64_t seed) noexcept
+{
+    return hash_long<accumulate_sse2, scramble_sse2>(p, len, seed);
+}
+
+__attribute__((target("avx2"))) inline uint64_t
+hash_long_avx2(const uint8_t * p, size_t len, uint64_t seed) noexcept
+{
+    return hash_long<accumulate_avx2, scramble_avx2>(p, len, seed);
+}
+
+#endif
+
+using hash_long_fn_t = uint64_t (*)(const uint8_t *, size_t,
+                                    uint64_t) noexcept;
+
+inline hash_long_fn_t
+select_hash_long() noexcept
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return hash_long_avx2;
+    return hash_long_sse2;
+#else
+    return hash_long_scalar;
+#endif
+}
+
+inline const hash_long_fn_t hash_long_fn { select_hash_long() };
+
+}       // namespace detail
+
+// Returns a 64 bit hash of the len bytes starting at data. Inputs up to
+// 128 bytes (nearly all sysfs attributes) never leave the inline paths.
+inline uint64_t
+hash64(const void * data, size_t len, uint64_t seed = 0) noexcept
+{
+    const uint8_t * p { static_cast<const uint8_t *>(data) };
+
+    if (len <= 16)
+        return detail::hash_0to16(p, len, seed);
+    if (len <= 128)
+        return detail::hash_17to128(p, len, seed);
+    return detail::hash_long_fn(p, len, seed);
+}
+
+}       // namespace cpf_hash
+
+#endif          // CPF_HASH_HPP